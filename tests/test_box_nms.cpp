@@ -0,0 +1,160 @@
+// GridNms keeps exactly the boxes of boxNms::pairwise, in the same order:
+// clustered and scattered candidates, degenerate and frame-sized boxes,
+// per class thresholds and quotas, and an out buffer smaller than the
+// result. The storage of one GridNms is reused across all calls.
+
+#include <stdlib.h>
+#include <vector>
+
+#include "box_nms.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+
+
+static struct v8xyxy _box(int x1, int y1, int x2, int y2, int c, float prob)
+{
+  struct v8xyxy b;
+  b.x1 = x1;
+  b.y1 = y1;
+  b.x2 = x2;
+  b.y2 = y2;
+  b.c = c;
+  b.c_prob = prob;
+  return b;
+}
+
+
+// Jittered boxes around objects, plus scattered and odd ones
+static vector<struct v8xyxy> _makeCandidates(int count, int perObject)
+{
+  vector<struct v8xyxy> boxes;
+  while ((int)boxes.size() < count)
+  {
+    int w = 4 + rand() % 200;
+    int h = 4 + rand() % 200;
+    int x = rand() % (640 - w);
+    int y = rand() % (384 - h);
+    int c = rand() % 6;
+    int n = 1 + rand() % perObject;
+
+    for (int i = 0; i < n && (int)boxes.size() < count; i++)
+    {
+      boxes.push_back(_box(x + rand() % 9 - 4, y + rand() % 9 - 4,
+        x + w + rand() % 9 - 4, y + h + rand() % 9 - 4, c, 0.2f + (rand() % 8000) / 10000.0f));
+    }
+
+    switch (rand() % 8)
+    {
+    case 0:
+      boxes.push_back(_box(0, 0, 639, 383, c, 0.9f));
+      break;
+    case 1:
+      boxes.push_back(_box(x, y, x, y, c, 0.5f));
+      break;
+    case 2:
+      boxes.push_back(_box(x, y, x + w, y + h, c, boxes.back().c_prob));
+      break;
+    default:
+      break;
+    }
+  }
+
+  return boxes;
+}
+
+
+static bool _sameBoxes(const vector<struct v8xyxy> &a, int numA, const vector<struct v8xyxy> &b, int numB)
+{
+  if (numA != numB)
+    return false;
+
+  for (int i = 0; i < numA; i++)
+  {
+    if (a[i].x1 != b[i].x1 || a[i].y1 != b[i].y1 || a[i].x2 != b[i].x2 || a[i].y2 != b[i].y2 ||
+        a[i].c != b[i].c || a[i].c_prob != b[i].c_prob)
+      return false;
+  }
+
+  return true;
+}
+
+
+static void _checkSmall()
+{
+  GridNms gridNms;
+  vector<struct v8xyxy> out(8);
+
+  // Same class overlapping: the higher score stays. Other class: kept.
+  vector<struct v8xyxy> boxes;
+  boxes.push_back(_box(10, 10, 50, 50, 1, 0.6f));
+  boxes.push_back(_box(12, 12, 52, 52, 1, 0.9f));
+  boxes.push_back(_box(12, 12, 52, 52, 2, 0.7f));
+  boxes.push_back(_box(200, 200, 240, 240, 1, 0.5f));
+  CHECK(gridNms.run(boxes, 0.5f, &out[0], (int)out.size()) == 3);
+  CHECK(out[0].c_prob == 0.9f && out[0].c == 1);
+  CHECK(out[1].c_prob == 0.7f && out[1].c == 2);
+  CHECK(out[2].c_prob == 0.5f);
+
+  boxes.clear();
+  CHECK(gridNms.run(boxes, 0.5f, &out[0], (int)out.size()) == 0);
+  CHECK(boxNms::pairwise(boxes, 0.5f, &out[0], (int)out.size()) == 0);
+}
+
+
+static void _checkRandom()
+{
+  NmsParams uniform = NmsParams::uniform(0.5f);
+  NmsParams loose = NmsParams::uniform(0.9f);
+  NmsParams strict = NmsParams::uniform(0.05f);
+  NmsParams perClass = uniform;
+  perClass.classes.resize(5);
+  perClass.classes[1].topK = 7;
+  perClass.classes[2].iouThreshold = 0.65f;
+  perClass.classes[3].confThreshold = 0.6f;
+  perClass.classes[4].confThreshold = 0.7f;
+  perClass.classes[4].iouThreshold = 0.3f;
+  perClass.classes[4].topK = 3;
+  const NmsParams *paramList[] = {&uniform, &loose, &strict, &perClass};
+
+  const int counts[] = {1, 2, 20, 300, 3000};
+  const int maxOutList[] = {5000, 5};
+
+  srand(1);
+  GridNms gridNms;
+  int mismatch = 0;
+  for (int round = 0; round < 20; round++)
+  {
+    for (size_t p = 0; p < sizeof(paramList) / sizeof(paramList[0]); p++)
+    {
+      for (size_t n = 0; n < sizeof(counts) / sizeof(counts[0]); n++)
+      {
+        vector<struct v8xyxy> candidates = _makeCandidates(counts[n], 12);
+        for (size_t m = 0; m < sizeof(maxOutList) / sizeof(maxOutList[0]); m++)
+        {
+          int maxOut = maxOutList[m];
+          vector<struct v8xyxy> outPairwise(maxOut), outGrid(maxOut);
+
+          vector<struct v8xyxy> work = candidates;
+          int numPairwise = boxNms::pairwise(work, *paramList[p], &outPairwise[0], maxOut);
+          work = candidates;
+          int numGrid = gridNms.run(work, *paramList[p], &outGrid[0], maxOut);
+
+          CHECK(numGrid <= maxOut);
+          if (!_sameBoxes(outPairwise, numPairwise, outGrid, numGrid))
+            mismatch++;
+        }
+      }
+    }
+  }
+  CHECK(mismatch == 0);
+}
+
+
+int main()
+{
+  _checkSmall();
+  _checkRandom();
+
+  return testResult("box_nms");
+}
@@ -0,0 +1,55 @@
+// BoxTracker: tracks carry the confidence of the detection they were last
+// matched with, also on the boxes predicted between detections.
+
+#include <vector>
+
+#include "box_tracker.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+
+
+static BoundingBox _makeBox(float x1, float y1, float x2, float y2, int label, float confidence)
+{
+  BoundingBox box(x1, y1, x2, y2, label);
+  box.confidence = confidence;
+  return box;
+}
+
+
+int main()
+{
+  BoxTracker tracker(640, 384);
+
+  // New track
+  vector<BoundingBox> detList;
+  detList.push_back(_makeBox(100, 100, 160, 200, 2, 0.8f));
+  tracker.update(detList, 0);
+  CHECK(tracker.getTrackNum() == 1);
+
+  vector<BoundingBox> predList;
+  tracker.predict(predList, 1);
+  CHECK(predList.size() == 1);
+  if (predList.size() == 1)
+  {
+    CHECK(predList[0].isPredicted);
+    CHECK_NEAR(predList[0].confidence, 0.8f, 1e-6f);
+  }
+
+  // Matched again, the confidence follows the new detection
+  detList.clear();
+  detList.push_back(_makeBox(104, 102, 164, 202, 2, 0.55f));
+  tracker.update(detList, 2);
+  CHECK(tracker.getTrackNum() == 1);
+
+  predList.clear();
+  tracker.predict(predList, 3);
+  CHECK(predList.size() == 1);
+  if (predList.size() == 1)
+  {
+    CHECK_NEAR(predList[0].confidence, 0.55f, 1e-6f);
+    CHECK(predList[0].x1 > 104.0f);
+  }
+
+  return testResult("box_tracker");
+}
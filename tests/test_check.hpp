@@ -0,0 +1,34 @@
+#ifndef __TEST_CHECK__
+#define __TEST_CHECK__
+
+#include <stdio.h>
+
+
+// Minimal check macros for the tests, a failed check is reported and the
+// test goes on; main returns testResult() as its exit status.
+static int s_testFailed = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) \
+    { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      s_testFailed++; \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(((a) - (b)) <= (eps) && ((b) - (a)) <= (eps))
+
+static inline int testResult(const char *name)
+{
+  if (s_testFailed > 0)
+  {
+    fprintf(stderr, "%s: %d check(s) failed\n", name, s_testFailed);
+    return 1;
+  }
+
+  printf("%s: passed\n", name);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,136 @@
+// halfKernel: scalar conversions against known values and round trips, the
+// array kernels (F16C / NEON when enabled) against the scalar ones, and the
+// threshold compare done on the stored halves.
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "half_float.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+
+
+static bool _sameBits(float a, float b)
+{
+  return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+
+static void _checkScalar()
+{
+  CHECK(halfKernel::toFloat(0x3c00) == 1.0f);
+  CHECK(halfKernel::toFloat(0xc000) == -2.0f);
+  CHECK(halfKernel::toFloat(0x7bff) == 65504.0f);
+  CHECK(halfKernel::toFloat(0x0001) == ldexpf(1.0f, -24));
+  CHECK(halfKernel::toFloat(0x03ff) == ldexpf(1023.0f, -24));
+  CHECK(_sameBits(halfKernel::toFloat(0x8000), -0.0f));
+  CHECK(isinf(halfKernel::toFloat(0x7c00)) && halfKernel::toFloat(0x7c00) > 0);
+  CHECK(isnan(halfKernel::toFloat(0x7e00)));
+
+  CHECK(halfKernel::fromFloat(1.0f) == 0x3c00);
+  CHECK(halfKernel::fromFloat(0.1f) == 0x2e66);
+  CHECK(halfKernel::fromFloat(-0.0f) == 0x8000);
+  CHECK(halfKernel::fromFloat(65504.0f) == 0x7bff);
+  CHECK(halfKernel::fromFloat(65520.0f) == 0x7c00);
+  CHECK(halfKernel::fromFloat(ldexpf(1.0f, -25)) == 0x0000);
+  CHECK(halfKernel::fromFloat(ldexpf(3.0f, -26)) == 0x0001);
+  CHECK((halfKernel::fromFloat(NAN) & 0x7fff) > 0x7c00);
+
+  // Halfway cases round to even
+  CHECK(halfKernel::fromFloat(1.0f + ldexpf(1.0f, -11)) == 0x3c00);
+  CHECK(halfKernel::fromFloat(1.0f + ldexpf(3.0f, -11)) == 0x3c02);
+  CHECK(halfKernel::fromFloat(ldexpf(3.0f, -25)) == 0x0002);
+
+  // Every half that isn't NaN comes back unchanged
+  int mismatch = 0;
+  for (uint32_t h = 0; h < 0x10000; h++)
+  {
+    if ((h & 0x7fff) > 0x7c00)
+      continue;
+    if (halfKernel::fromFloat(halfKernel::toFloat((uint16_t)h)) != h)
+      mismatch++;
+  }
+  CHECK(mismatch == 0);
+}
+
+
+static void _checkArray()
+{
+  // All halves, then short lengths for the scalar tails
+  vector<uint16_t> src(0x10000);
+  for (uint32_t h = 0; h < 0x10000; h++)
+    src[h] = (uint16_t)h;
+
+  vector<float> dst(src.size());
+  halfKernel::toFloat(src.data(), dst.data(), src.size());
+  int mismatch = 0;
+  for (size_t i = 0; i < src.size(); i++)
+  {
+    float ref = halfKernel::toFloat(src[i]);
+    if (!_sameBits(dst[i], ref) && !(isnan(dst[i]) && isnan(ref)))
+      mismatch++;
+  }
+  CHECK(mismatch == 0);
+
+  vector<float> values;
+  for (int i = -2000; i <= 2000; i++)
+    values.push_back(i * 0.37f);
+  values.push_back(1.0f + ldexpf(1.0f, -11));
+  values.push_back(ldexpf(3.0f, -26));
+  values.push_back(70000.0f);
+  values.push_back(-70000.0f);
+
+  vector<uint16_t> halves(values.size());
+  halfKernel::fromFloat(values.data(), halves.data(), values.size());
+  mismatch = 0;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    if (halves[i] != halfKernel::fromFloat(values[i]))
+      mismatch++;
+  }
+  CHECK(mismatch == 0);
+
+  for (size_t n = 0; n <= 19; n++)
+  {
+    vector<float> out(n + 1, -1.0f);
+    halfKernel::toFloat(src.data() + 0x3c00, out.data(), n);
+    bool same = out[n] == -1.0f;
+    for (size_t i = 0; i < n; i++)
+      same = same && out[i] == halfKernel::toFloat((uint16_t)(0x3c00 + i));
+    CHECK(same);
+  }
+}
+
+
+static void _checkThreshold()
+{
+  float thresholdList[] = {0.0f, 0.001f, 0.1f, 0.25f, 0.3f, 0.5f, 0.999f, 1.0f};
+  for (size_t t = 0; t < sizeof(thresholdList) / sizeof(thresholdList[0]); t++)
+  {
+    float threshold = thresholdList[t];
+    uint16_t thresholdH = halfKernel::thresholdFromFloat(threshold);
+
+    int mismatch = 0;
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+      float v = halfKernel::toFloat((uint16_t)h);
+      if (isnan(v))
+        continue;
+      if (halfKernel::isAtLeast((uint16_t)h, thresholdH) != (v >= threshold && !(h & 0x8000)))
+        mismatch++;
+    }
+    CHECK(mismatch == 0);
+  }
+}
+
+
+int main()
+{
+  _checkScalar();
+  _checkArray();
+  _checkThreshold();
+
+  return testResult("half_float");
+}
@@ -0,0 +1,148 @@
+// RawHeadDecoder: a known anchor decodes to its box, class and score, and
+// the anchor major and channel major layouts of one head give the same
+// candidates, and the candidate cap keeps the best ones.
+
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "raw_head_decoder.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+
+
+#define INPUT_W 320
+#define INPUT_H 192
+#define NUM_CLASSES 5
+
+
+// Value of channel c of anchor a in either layout
+static float &_at(vector<float> &raw, int a, int c, int numAnchors, int numChannels, bool channelMajor)
+{
+  return channelMajor ? raw[(size_t)c * numAnchors + a] : raw[(size_t)a * numChannels + c];
+}
+
+
+// One anchor of the stride 8 grid with a peaked bin per side, everything
+// else far below any threshold
+static void _checkKnownAnchor(bool channelMajor)
+{
+  RawHeadDecoder decoder(INPUT_W, INPUT_H, NUM_CLASSES);
+  decoder.setChannelMajor(channelMajor);
+  int numAnchors = decoder.getNumAnchors();
+  int numChannels = decoder.getNumChannels();
+  CHECK(numAnchors == 40 * 24 + 20 * 12 + 10 * 6);
+
+  vector<float> raw((size_t)numAnchors * numChannels, -100.0f);
+
+  // Cell (10, 5), center (84, 44) in input pixels
+  int a = 5 * (INPUT_W / 8) + 10;
+  int bins[4] = {3, 2, 5, 4};
+  for (int side = 0; side < 4; side++)
+    _at(raw, a, side * DFL_BINS + bins[side], numAnchors, numChannels, channelMajor) = 0.0f;
+  _at(raw, a, 4 * DFL_BINS + 2, numAnchors, numChannels, channelMajor) = 2.0f;
+
+  vector<struct v8xyxy> candidates;
+  CHECK(decoder.decode(raw.data(), 0.5f, candidates) == 1);
+  if (candidates.size() == 1)
+  {
+    CHECK(candidates[0].x1 == 84 - 3 * 8);
+    CHECK(candidates[0].y1 == 44 - 2 * 8);
+    CHECK(candidates[0].x2 == 84 + 5 * 8);
+    CHECK(candidates[0].y2 == 44 + 4 * 8);
+    CHECK(candidates[0].c == 2);
+    CHECK_NEAR(candidates[0].c_prob, 1.0f / (1.0f + expf(-2.0f)), 1e-5f);
+  }
+
+  // Below the threshold
+  CHECK(decoder.decode(raw.data(), 0.9f, candidates) == 0);
+
+  // Past the input, clamped to its first and last pixels
+  _at(raw, a, 2 * DFL_BINS + bins[2], numAnchors, numChannels, channelMajor) = -100.0f;
+  _at(raw, a, 2 * DFL_BINS + 15, numAnchors, numChannels, channelMajor) = 0.0f;
+  int lastA = numAnchors - 1;
+  for (int side = 0; side < 4; side++)
+    _at(raw, lastA, side * DFL_BINS + 15, numAnchors, numChannels, channelMajor) = 0.0f;
+  _at(raw, lastA, 4 * DFL_BINS, numAnchors, numChannels, channelMajor) = 3.0f;
+
+  CHECK(decoder.decode(raw.data(), 0.5f, candidates) == 2);
+  if (candidates.size() == 2)
+  {
+    CHECK(candidates[0].x2 == 84 + 15 * 8);
+    CHECK(candidates[1].x1 == 0);
+    CHECK(candidates[1].y1 == 0);
+    CHECK(candidates[1].x2 == INPUT_W - 1);
+    CHECK(candidates[1].y2 == INPUT_H - 1);
+    CHECK(candidates[1].c == 0);
+  }
+}
+
+
+// The same random head in both layouts
+static void _checkLayouts()
+{
+  RawHeadDecoder anchorMajor(INPUT_W, INPUT_H, NUM_CLASSES);
+  RawHeadDecoder channelMajor(INPUT_W, INPUT_H, NUM_CLASSES);
+  channelMajor.setChannelMajor(true);
+  CHECK(!anchorMajor.isChannelMajor() && channelMajor.isChannelMajor());
+
+  int numAnchors = anchorMajor.getNumAnchors();
+  int numChannels = anchorMajor.getNumChannels();
+  vector<float> rawA((size_t)numAnchors * numChannels);
+  vector<float> rawC(rawA.size());
+
+  std::mt19937 rng(1);
+  std::normal_distribution<float> dist(-2.0f, 2.0f);
+  for (int a = 0; a < numAnchors; a++)
+  {
+    for (int c = 0; c < numChannels; c++)
+    {
+      float v = dist(rng);
+      _at(rawA, a, c, numAnchors, numChannels, false) = v;
+      _at(rawC, a, c, numAnchors, numChannels, true) = v;
+    }
+  }
+
+  vector<struct v8xyxy> outA, outC;
+  anchorMajor.decode(rawA.data(), 0.6f, outA);
+  channelMajor.decode(rawC.data(), 0.6f, outC);
+  CHECK(!outA.empty() && outA.size() < 1024);
+  CHECK(outA.size() == outC.size());
+
+  bool same = outA.size() == outC.size();
+  for (size_t i = 0; same && i < outA.size(); i++)
+  {
+    same = outA[i].x1 == outC[i].x1 && outA[i].y1 == outC[i].y1 &&
+      outA[i].x2 == outC[i].x2 && outA[i].y2 == outC[i].y2 &&
+      outA[i].c == outC[i].c && outA[i].c_prob == outC[i].c_prob;
+  }
+  CHECK(same);
+  CHECK(anchorMajor.getLastDropped() == 0);
+
+  // Capped: the best scores are kept and the rest counted
+  anchorMajor.setMaxCandidates(10);
+  vector<struct v8xyxy> outCapped;
+  anchorMajor.decode(rawA.data(), 0.6f, outCapped);
+  CHECK(outCapped.size() == 10);
+  CHECK(anchorMajor.getLastDropped() == (int)outA.size() - 10);
+
+  float minKept = 1.0f;
+  for (size_t i = 0; i < outCapped.size(); i++)
+    minKept = std::min(minKept, outCapped[i].c_prob);
+  int above = 0;
+  for (size_t i = 0; i < outA.size(); i++)
+    above += outA[i].c_prob > minKept;
+  CHECK(above < 10);
+}
+
+
+int main()
+{
+  _checkKnownAnchor(false);
+  _checkKnownAnchor(true);
+  _checkLayouts();
+
+  return testResult("raw_head_decoder");
+}
@@ -0,0 +1,154 @@
+// TensorRecordWriter / Reader: LZ4 blocks decompress to what was compressed,
+// and recorded frames come back unchanged, compressed or not, also when a
+// frame spans several chunks.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tensor_record.hpp"
+#include "test_check.hpp"
+
+using namespace std;
+
+
+// Random bytes, runs, repeats at a short distance and float maps: the
+// literal, match and overlapping match cases of the block format
+static vector<uint8_t> _makeData(std::mt19937 &rng, size_t size, int kind)
+{
+  vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++)
+  {
+    if (kind == 0)
+      data[i] = (uint8_t)rng();
+    else if (kind == 1)
+      data[i] = (uint8_t)((i / 7) % 3);
+    else if (kind == 2)
+      data[i] = (rng() % 8 == 0 || i < 16) ? (uint8_t)rng() : data[i - 16];
+    else if (i % 4 == 0 && i + 4 <= size)
+    {
+      float f = (rng() % 100) / 10.0f;
+      memcpy(&data[i], &f, sizeof(f));
+    }
+  }
+
+  return data;
+}
+
+
+static void _checkLz4()
+{
+  std::mt19937 rng(1);
+  size_t sizeList[] = {0, 1, 5, 12, 13, 64, 1000, 65536, 65537, 200000};
+
+  for (size_t s = 0; s < sizeof(sizeList) / sizeof(sizeList[0]); s++)
+  {
+    for (int kind = 0; kind < 4; kind++)
+    {
+      vector<uint8_t> src = _makeData(rng, sizeList[s], kind);
+      vector<uint8_t> packed(lz4BlockBound(src.size()));
+      size_t packedSize = lz4BlockCompress(src.data(), src.size(), packed.data(), packed.size());
+      CHECK(packedSize <= packed.size());
+
+      vector<uint8_t> dst(src.size() + 1);
+      size_t dstSize = lz4BlockDecompress(packed.data(), packedSize, dst.data(), src.size());
+      CHECK(dstSize == src.size());
+      CHECK(src.empty() || memcmp(src.data(), dst.data(), src.size()) == 0);
+    }
+  }
+}
+
+
+static void _checkRecord(bool compress)
+{
+  char path[] = "/tmp/test_tensor_record_XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  if (fd < 0)
+    return;
+  close(fd);
+
+  // Small chunks, so that frames are split over several of them
+  const int frameCount = 50;
+  {
+    TensorRecordWriter writer(path, compress, 16 << 10);
+    for (int f = 0; f < frameCount; f++)
+    {
+      uint32_t inputShape[4] = {1, 384, 640, 3};
+      CHECK(writer.beginFrame(f, 1000 * f, inputShape));
+
+      vector<float> seg(3000 + f);
+      for (size_t i = 0; i < seg.size(); i++)
+        seg[i] = (float)(i % 10 + f);
+      vector<float> conf(500);
+      for (size_t i = 0; i < conf.size(); i++)
+        conf[i] = (float)((i * 31 + f) % 97) / 97.0f;
+
+      uint32_t segShape[4] = {1, 1, 1, (uint32_t)seg.size()};
+      uint32_t confShape[4] = {1, 1, 1, (uint32_t)conf.size()};
+      CHECK(writer.addTensor("lane_output", 0, segShape, sizeof(float), seg.data(), seg.size() * sizeof(float)));
+      CHECK(writer.addTensor("det_conf", 0, confShape, sizeof(float), conf.data(), conf.size() * sizeof(float)));
+      CHECK(writer.endFrame());
+    }
+    CHECK(writer.close());
+  }
+
+  TensorRecordReader reader;
+  CHECK(reader.open(path));
+
+  RecordedFrame frame;
+  int count = 0;
+  while (reader.next(frame))
+  {
+    CHECK(frame.header.seq == (uint64_t)count);
+    CHECK(frame.header.timestampUs == 1000 * count);
+    CHECK(frame.header.inputShape[2] == 640);
+
+    const RecordedTensor *seg = frame.find("lane_output");
+    CHECK(seg != NULL);
+    if (seg != NULL)
+    {
+      CHECK(seg->desc.size == (3000 + count) * sizeof(float));
+      const float *v = (const float *)seg->data;
+      bool same = true;
+      for (int i = 0; i < 3000 + count; i++)
+        same = same && v[i] == (float)(i % 10 + count);
+      CHECK(same);
+    }
+
+    const RecordedTensor *conf = frame.find("det_conf");
+    CHECK(conf != NULL);
+    if (conf != NULL)
+    {
+      const float *v = (const float *)conf->data;
+      bool same = true;
+      for (int i = 0; i < 500; i++)
+        same = same && v[i] == (float)((i * 31 + count) % 97) / 97.0f;
+      CHECK(same);
+    }
+    CHECK(frame.find("det_box") == NULL);
+    count++;
+  }
+  CHECK(count == frameCount);
+
+  // And again from the start
+  CHECK(reader.rewind());
+  CHECK(reader.next(frame) && frame.header.seq == 0);
+  reader.close();
+
+  unlink(path);
+}
+
+
+int main()
+{
+  _checkLz4();
+  _checkRecord(true);
+  _checkRecord(false);
+
+  return testResult("tensor_record");
+}
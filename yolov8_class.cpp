@@ -12,9 +12,62 @@
 #include "yolov8_utils/object.hpp"
 #include "yolov8_utils/point.hpp"
 #include "yolov8_utils/bounding_box.hpp"
+#include "lua.hpp"
 using namespace cv;
 // #define atoa(x)
 
+static uint64_t live_get_time_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Look for the yolov8 arm config (the table holding output_0) in the table on
+// the top of the lua stack, descending at most depth levels.
+static int live_lua_find_arm_cfg(lua_State *L, int depth, yolov8_arm_cfg_t *cfg)
+{
+	int found = 0;
+
+	lua_getfield(L, -1, "output_0");
+	if (lua_type(L, -1) == LUA_TSTRING) {
+		strncpy(cfg->output_0, lua_tostring(L, -1), YOLOV8_MAX_STR_LEN - 1);
+		found = 1;
+	}
+	lua_pop(L, 1);
+	if (found) {
+		lua_getfield(L, -1, "output_1");
+		if (lua_type(L, -1) == LUA_TSTRING) {
+			strncpy(cfg->output_1, lua_tostring(L, -1), YOLOV8_MAX_STR_LEN - 1);
+		}
+		lua_pop(L, 1);
+		lua_getfield(L, -1, "enable_seg");
+		if (lua_isboolean(L, -1)) {
+			cfg->enable_seg = lua_toboolean(L, -1);
+		} else {
+			cfg->enable_seg = (int)lua_tointeger(L, -1);
+		}
+		lua_pop(L, 1);
+		return found;
+	}
+	if (depth == 0) {
+		return found;
+	}
+
+	lua_pushnil(L);
+	while (found == 0 && lua_next(L, -2) != 0) {
+		if (lua_type(L, -1) == LUA_TTABLE) {
+			found = live_lua_find_arm_cfg(L, depth - 1, cfg);
+		}
+		lua_pop(L, 1);
+	}
+	if (found) {
+		lua_pop(L, 1);
+	}
+
+	return found;
+}
+
 
 YoloV8_Class::YoloV8_Class(int argc, char **argv)
 {
@@ -22,6 +75,13 @@ YoloV8_Class::YoloV8_Class(int argc, char **argv)
 
 	params = new live_params_t;
 	live_ctx = new live_ctx_t;
+	for (int i = 0; i < LIVE_MAX_STREAM_NUM; i++) {
+		tracker[i] = NULL;
+	}
+	frame_writer = NULL;
+	tensor_recorder = NULL;
+	tensor_replayer = NULL;
+	replay_pending = 0;
 
 	rval = init_param(argc, argv, params);
 	rval = live_init(live_ctx, params);
@@ -32,6 +92,13 @@ YoloV8_Class::YoloV8_Class(int argc, char **argv, live_params_t *params, live_ct
 	// params = new live_params_t;
 	// live_ctx = new live_ctx_t;
 	int rval = 0;
+	for (int i = 0; i < LIVE_MAX_STREAM_NUM; i++) {
+		tracker[i] = NULL;
+	}
+	frame_writer = NULL;
+	tensor_recorder = NULL;
+	tensor_replayer = NULL;
+	replay_pending = 0;
 	rval = init_param(argc, argv, params);
 	rval = live_init(live_ctx, params);
 }
@@ -39,6 +106,10 @@ YoloV8_Class::~YoloV8_Class()
 {
 	
 
+	live_prefetch_deinit(live_ctx);
+	live_record_deinit();
+	live_batch_deinit(live_ctx);
+	live_stream_deinit(live_ctx);
 	post_thread_deinit( &live_ctx->thread_ctx, &live_ctx->nn_cvflow);
 	nn_cvflow_deinit(&live_ctx->nn_cvflow);
 	cv_env_deinit(live_ctx);
@@ -47,6 +118,16 @@ YoloV8_Class::~YoloV8_Class()
 		live_ctx->f_result = -1;
 	}
 
+	for (int i = 0; i < LIVE_MAX_STREAM_NUM; i++) {
+		delete tracker[i];
+		tracker[i] = nullptr;
+	}
+	delete frame_writer;
+	frame_writer = nullptr;
+	delete tensor_recorder;
+	tensor_recorder = nullptr;
+	delete tensor_replayer;
+	tensor_replayer = nullptr;
 	delete params;
 	delete live_ctx;
 
@@ -134,6 +215,9 @@ int YoloV8_Class::parse_param(int argc, char **argv, live_params_t *params)
 			case OPTION_SUPPORT_LIST:
 				params->support = 1;
 				break;
+			case OPTION_CONVERT_BENCH:
+				params->convert_bench = 1;
+				break;
 			case 'd':
 				value = atoi(optarg);
 				if (value < DRAW_BBOX_TEXTBOX || value > DRAW_256_COLORS_IMAGE) {
@@ -274,6 +358,15 @@ int YoloV8_Class::parse_param(int argc, char **argv, live_params_t *params)
 				}
 				params->acinf_gpu_id = value;
 				break;
+			case OPTION_TRACK_INTERVAL:
+				value = atoi(optarg);
+				if (value < 1) {
+					EA_LOG_ERROR("track interval should be >= 1, default is 1\n");
+					rval = EA_FAIL;
+					break;
+				}
+				params->track_interval = value;
+				break;
 			case OPTION_OVERLAY_BUF_OFFSET:
 				params->overlay_buffer_offset = atoi(optarg);
 				break;
@@ -287,6 +380,91 @@ int YoloV8_Class::parse_param(int argc, char **argv, live_params_t *params)
 			case OPTION_HOLD_IMG:
 				params->enable_hold_img_flag = IN_SRC_ON;
 				break;
+			case OPTION_PREFETCH:
+				params->enable_prefetch_flag = IN_SRC_ON;
+				break;
+			case OPTION_MULTI_CANVAS:
+				params->stream_num = sscanf(optarg, "%d,%d,%d,%d",
+					&params->stream_canvas[0], &params->stream_canvas[1],
+					&params->stream_canvas[2], &params->stream_canvas[3]);
+				if (params->stream_num < 1) {
+					EA_LOG_ERROR("multi canvas parameters are wrong, %s\n", optarg);
+					rval = EA_FAIL;
+					break;
+				}
+				for (value = 0; value < params->stream_num; value++) {
+					if (params->stream_canvas[value] < 0) {
+						EA_LOG_ERROR("canvas ID is wrong, %d\n", params->stream_canvas[value]);
+						rval = EA_FAIL;
+						break;
+					}
+				}
+				RVAL_BREAK();
+				params->canvas_id = params->stream_canvas[0];
+				params->feature |= IN_TYPE_CANVAS_BUFFER;
+				break;
+			case OPTION_FRAME_DUMP:
+				if (strlen(optarg) == 0) {
+					EA_LOG_ERROR("The path of frame dump file is empty\n");
+					rval = EA_FAIL;
+					break;
+				}
+				params->frame_dump_path = optarg;
+				break;
+			case OPTION_RECORD_OUTPUT:
+				if (strlen(optarg) == 0) {
+					EA_LOG_ERROR("The path of record file is empty\n");
+					rval = EA_FAIL;
+					break;
+				}
+				params->record_output_path = optarg;
+				break;
+			case OPTION_RECORD_LZ4:
+				params->record_compress_flag = IN_SRC_ON;
+				break;
+			case OPTION_REPLAY_OUTPUT:
+				if (strlen(optarg) == 0) {
+					EA_LOG_ERROR("The path of replay file is empty\n");
+					rval = EA_FAIL;
+					break;
+				}
+				params->replay_output_path = optarg;
+				break;
+			case OPTION_FILE_BATCH:
+				params->file_batch_flag = IN_SRC_ON;
+				break;
+			case OPTION_BATCH_WINDOW:
+				params->batch_window_ms = atof(optarg);
+				if (params->batch_window_ms < 0) {
+					EA_LOG_ERROR("batch window should be >= 0, %s\n", optarg);
+					rval = EA_FAIL;
+					break;
+				}
+				break;
+			case OPTION_LATENCY_SLO:
+				value = sscanf(optarg, "%f,%f,%f,%f",
+					&params->latency_slo_ms[0], &params->latency_slo_ms[1],
+					&params->latency_slo_ms[2], &params->latency_slo_ms[3]);
+				if (value < 1) {
+					EA_LOG_ERROR("latency slo parameters are wrong, %s\n", optarg);
+					rval = EA_FAIL;
+					break;
+				}
+				// one value applies to every canvas
+				for (; value < LIVE_MAX_STREAM_NUM; value++) {
+					params->latency_slo_ms[value] = params->latency_slo_ms[0];
+				}
+				break;
+			case OPTION_STREAM_WEIGHT:
+				value = sscanf(optarg, "%d,%d,%d,%d",
+					&params->stream_weight[0], &params->stream_weight[1],
+					&params->stream_weight[2], &params->stream_weight[3]);
+				if (value < 1) {
+					EA_LOG_ERROR("stream weight parameters are wrong, %s\n", optarg);
+					rval = EA_FAIL;
+					break;
+				}
+				break;
 			case OPTION_IN_ROI:
 				value = sscanf(optarg, "%d,%d,%d,%d",
 					&(params->roi.x), &(params->roi.y),
@@ -332,6 +510,7 @@ int YoloV8_Class::parse_param(int argc, char **argv, live_params_t *params)
 int YoloV8_Class::check_params(live_params_t *params)
 {
 	int rval = EA_SUCCESS;
+	int i;
 	do {
 		if (((params->feature & OUT_TYPE_LIVE) == OUT_TYPE_LIVE ||
 			((params->feature & OUT_TYPE_LIVE) == 0 &&
@@ -347,6 +526,50 @@ int YoloV8_Class::check_params(live_params_t *params)
 			rval = EA_FAIL;
 			break;
 		}
+		if (params->stream_num > 1 &&
+			(params->mode != RUN_LIVE_MODE || params->use_pyramid == IN_SRC_ON)) {
+			EA_LOG_ERROR("Multi canvas is only supported with canvas buffer in live mode.\n");
+			rval = EA_FAIL;
+			break;
+		}
+		if (params->stream_num > 1 &&
+			params->enable_prefetch_flag == IN_SRC_ON) {
+			EA_LOG_ERROR("Multi canvas and prefetch are set simultaneously. Only support one of them.\n");
+			rval = EA_FAIL;
+			break;
+		}
+		if (params->file_batch_flag == IN_SRC_ON &&
+			params->mode != RUN_FILE_MODE) {
+			EA_LOG_ERROR("File batch is only supported in file mode.\n");
+			rval = EA_FAIL;
+			break;
+		}
+		if (params->record_output_path &&
+			(params->batch_window_ms > 0 || params->file_batch_flag == IN_SRC_ON)) {
+			EA_LOG_ERROR("Record output is not supported with micro-batching.\n");
+			rval = EA_FAIL;
+			break;
+		}
+		if (params->replay_output_path &&
+			(params->mode == RUN_DUMMY_MODE || params->record_output_path ||
+			params->enable_prefetch_flag == IN_SRC_ON || params->batch_window_ms > 0 ||
+			params->file_batch_flag == IN_SRC_ON)) {
+			EA_LOG_ERROR("Replay output is not supported with dummy mode, record output, prefetch or batching.\n");
+			rval = EA_FAIL;
+			break;
+		}
+		if (params->batch_window_ms > 0 && params->track_interval > 1) {
+			EA_LOG_ERROR("Batch window and track interval are set simultaneously. Only support one of them.\n");
+			rval = EA_FAIL;
+			break;
+		}
+		for (i = 0; i < LIVE_MAX_STREAM_NUM; i++) {
+			if (params->stream_weight[i] < 1) {
+				EA_LOG_ERROR("stream weight should be >= 1, %d\n", params->stream_weight[i]);
+				rval = EA_FAIL;
+				break;
+			}
+		}
 	} while (0);
 
 	return rval;
@@ -366,6 +589,9 @@ int YoloV8_Class::init_param(int argc, char **argv, live_params_t *params)
 	params->yuv_flag = IN_SRC_OFF;
 	params->use_pyramid = IN_SRC_OFF;
 	params->enable_fsync_flag = IN_SRC_ON;
+	params->enable_prefetch_flag = IN_SRC_OFF;
+	params->file_batch_flag = IN_SRC_OFF;
+	params->record_compress_flag = IN_SRC_OFF;
 
 	params->canvas_id = DEFAULT_CANVAS_ID;
 	params->vout_id = DEFAULT_VOUT_ID;
@@ -374,7 +600,11 @@ int YoloV8_Class::init_param(int argc, char **argv, live_params_t *params)
 	params->queue_size = 1;
 	params->thread_num = 1;
 	params->acinf_gpu_id = -1;
+	params->track_interval = 1;
 	params->overlay_buffer_offset = -1;
+	for (int i = 0; i < LIVE_MAX_STREAM_NUM; i++) {
+		params->stream_weight[i] = 1;
+	}
 
 	do {
 		if (argc < 2) {
@@ -387,6 +617,11 @@ int YoloV8_Class::init_param(int argc, char **argv, live_params_t *params)
 			support_list();
 			exit(0);
 		}
+		if (params->convert_bench) {
+			imgConvert::benchmarkPlanarToInterleaved(1920, 1080, 50);
+			imgConvert::benchmarkPlanarToInterleaved(3840, 2160, 20);
+			exit(0);
+		}
 
 		RVAL_OK(check_params(params));
 		if (params->mode == RUN_LIVE_MODE) {
@@ -406,6 +641,10 @@ int YoloV8_Class::init_param(int argc, char **argv, live_params_t *params)
 				}
 			}
 		}
+		if (params->stream_num == 0) {
+			params->stream_num = 1;
+			params->stream_canvas[0] = params->canvas_id;
+		}
 
 		EA_LOG_SET_LOCAL(params->log_level);
 		EA_LOG_NOTICE("live parameters:\n");
@@ -421,6 +660,14 @@ int YoloV8_Class::init_param(int argc, char **argv, live_params_t *params)
 		EA_LOG_NOTICE("\tqueue size: %d\n", params->queue_size);
 		EA_LOG_NOTICE("\trgb type: %d\n", params->rgb);
 		EA_LOG_NOTICE("\tcanvas id: %d\n", params->canvas_id);
+		EA_LOG_NOTICE("\tprefetch: %d\n", params->enable_prefetch_flag);
+		EA_LOG_NOTICE("\ttrack interval: %d\n", params->track_interval);
+		EA_LOG_NOTICE("\tstream number: %d\n", params->stream_num);
+		EA_LOG_NOTICE("\tbatch window: %.1f ms\n", params->batch_window_ms);
+		EA_LOG_NOTICE("\tfile batch: %d\n", params->file_batch_flag);
+		EA_LOG_NOTICE("\tframe dump: %s\n", params->frame_dump_path);
+		EA_LOG_NOTICE("\trecord output: %s\n", params->record_output_path);
+		EA_LOG_NOTICE("\treplay output: %s\n", params->replay_output_path);
 		EA_LOG_NOTICE("\tfile name of saving result to txt: %s\n",
 			params->result_f_path);
 
@@ -459,15 +706,14 @@ void YoloV8_Class::live_set_post_thread_params(live_params_t *params,
 	}
 };
 
-int YoloV8_Class::cv_env_init(live_ctx_t *live_ctx, live_params_t *params)
+int YoloV8_Class::live_input_init(nn_input_context_type_t *ctx,
+	live_params_t *params, int canvas_id)
 {
 	int rval = EA_SUCCESS;
 	nn_input_ops_type_t *ops = NULL;
-	nn_input_context_type_t *ctx;
 	int i;
 	do {
-		ctx = &live_ctx->nn_input_ctx;
-		ctx->canvas_id = params->canvas_id;
+		ctx->canvas_id = canvas_id;
 		ctx->stream_id = params->stream_id;
 		ctx->use_pyramid = params->use_pyramid;
 		ctx->feature = params->feature;
@@ -497,6 +743,134 @@ int YoloV8_Class::cv_env_init(live_ctx_t *live_ctx, live_params_t *params)
 	return rval;
 };
 
+int YoloV8_Class::cv_env_init(live_ctx_t *live_ctx, live_params_t *params)
+{
+	return live_input_init(&live_ctx->nn_input_ctx, params, params->canvas_id);
+};
+
+int YoloV8_Class::live_stream_init(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	live_stream_ctx_t *stream = NULL;
+	nn_input_ops_type_t *ops = live_ctx->nn_input_ctx.ops;
+	int i;
+
+	do {
+		live_ctx->stream_num = params->stream_num > 0 ? params->stream_num : 1;
+		live_ctx->cur_stream = 0;
+		for (i = 0; i < live_ctx->stream_num; i++) {
+			stream = &live_ctx->stream[i];
+			stream->canvas_id = params->stream_canvas[i];
+			stream->weight = params->stream_weight[i];
+			stream->calc_fps_ctx.count_period = DEFAULT_FPS_COUNT_PERIOD;
+			if (i == 0) {
+				stream->input_ctx = &live_ctx->nn_input_ctx;
+				stream->thread_ctx = &live_ctx->thread_ctx;
+				continue;
+			}
+
+			// Only the first canvas draws on vout/stream, the results of
+			// the others are fetched per stream by the caller.
+			stream->input_ctx = &stream->input_storage;
+			stream->thread_ctx = &stream->thread_storage;
+			RVAL_OK(live_input_init(stream->input_ctx, params, stream->canvas_id));
+			stream->input_inited = 1;
+			stream->input_ctx->net = live_ctx->nn_cvflow.net;
+			stream->input_ctx->feature &= ~(OUT_TYPE_VOUT | OUT_TYPE_STREAM);
+			stream->input_ctx->stream_id = -1;
+			stream->input_ctx->vout_id = -1;
+			RVAL_OK(ops->nn_input_check_params(stream->input_ctx));
+
+			live_set_post_thread_params(params, &stream->thread_ctx->params);
+			stream->thread_ctx->display = stream->input_ctx->display;
+			stream->thread_ctx->input_ctx = stream->input_ctx;
+			stream->thread_ctx->f_result = live_ctx->f_result;
+			RVAL_OK(post_thread_init(stream->thread_ctx, &live_ctx->nn_cvflow));
+			stream->thread_inited = 1;
+			RVAL_OK(post_thread_set_notifier(stream->thread_ctx, notifier, &live_ctx->sig_flag));
+			EA_LOG_NOTICE("stream %d: canvas %d, weight %d\n", i,
+				stream->canvas_id, stream->weight);
+		}
+	} while (0);
+
+	return rval;
+};
+
+void YoloV8_Class::live_stream_deinit(live_ctx_t *live_ctx)
+{
+	live_stream_ctx_t *stream = NULL;
+	int i;
+
+	for (i = 0; i < LIVE_MAX_STREAM_NUM; i++) {
+		stream = &live_ctx->stream[i];
+		if (stream->track_img_set.bgr) {
+			ea_tensor_free(stream->track_img_set.bgr);
+			stream->track_img_set.bgr = NULL;
+		}
+		// stream 0 uses the storage of live_ctx_t, these are never set
+		if (stream->thread_inited) {
+			post_thread_deinit(&stream->thread_storage, &live_ctx->nn_cvflow);
+			stream->thread_inited = 0;
+		}
+		if (stream->input_inited) {
+			if (stream->input_storage.ops &&
+				stream->input_storage.ops->nn_input_deinit) {
+				stream->input_storage.ops->nn_input_deinit(&stream->input_storage);
+			}
+			stream->input_inited = 0;
+		}
+	}
+};
+
+int YoloV8_Class::live_stream_schedule(live_ctx_t *live_ctx)
+{
+	live_stream_ctx_t *stream = NULL;
+	int total_weight = 0;
+	int best = -1;
+	int i;
+
+	// smooth weighted round-robin: a stream of weight w is picked w times
+	// per round, interleaved with the others instead of in a burst
+	for (i = 0; i < live_ctx->stream_num; i++) {
+		stream = &live_ctx->stream[i];
+		if (stream->eof) {
+			continue;
+		}
+		stream->current_weight += stream->weight;
+		total_weight += stream->weight;
+		if (best < 0 ||
+			stream->current_weight > live_ctx->stream[best].current_weight) {
+			best = i;
+		}
+	}
+	if (best >= 0) {
+		live_ctx->stream[best].current_weight -= total_weight;
+	}
+
+	return best;
+};
+
+void YoloV8_Class::live_stream_stat(live_ctx_t *live_ctx,
+	live_stream_ctx_t *stream, uint64_t latency_us)
+{
+	stream->latency_us_sum += latency_us;
+	if (latency_us > stream->latency_us_max) {
+		stream->latency_us_max = latency_us;
+	}
+	stream->stat_count++;
+	if (live_ctx->stream_num > 1 &&
+		stream->stat_count == INTERVAL_PRINT_PROCESS_TIME) {
+		EA_LOG_NOTICE("canvas %d: hold to queue latency avg %.2f ms, max %.2f ms, slo miss %d\n",
+			stream->canvas_id,
+			stream->latency_us_sum / 1000.0f / stream->stat_count,
+			stream->latency_us_max / 1000.0f, stream->slo_miss);
+		stream->latency_us_sum = 0;
+		stream->latency_us_max = 0;
+		stream->slo_miss = 0;
+		stream->stat_count = 0;
+	}
+};
+
 
 
 int YoloV8_Class::live_init(live_ctx_t *live_ctx, live_params_t *params)
@@ -509,6 +883,10 @@ int YoloV8_Class::live_init(live_ctx_t *live_ctx, live_params_t *params)
 		RVAL_ASSERT(params != NULL);
 		live_ctx->loop_count = INTERVAL_PRINT_PROCESS_TIME;
 		live_ctx->f_result = -1;
+		memset(&live_ctx->prefetch, 0, sizeof(live_prefetch_ctx_t));
+		memset(live_ctx->stream, 0, sizeof(live_ctx->stream));
+		live_ctx->stream_num = 0;
+		memset(&live_ctx->batch, 0, sizeof(live_batch_ctx_t));
 		if (params->result_f_path &&
 			params->mode == RUN_FILE_MODE) {
 			live_ctx->f_result = open(params->result_f_path, O_CREAT | O_RDWR | O_TRUNC, 0644);
@@ -534,6 +912,13 @@ int YoloV8_Class::live_init(live_ctx_t *live_ctx, live_params_t *params)
 			live_ctx->thread_ctx.f_result = live_ctx->f_result;
 			RVAL_OK(post_thread_init(&live_ctx->thread_ctx, &live_ctx->nn_cvflow));
 			RVAL_OK(post_thread_set_notifier(&live_ctx->thread_ctx, notifier, &live_ctx->sig_flag));
+			RVAL_OK(live_declare_output_usage(live_ctx, params));
+			RVAL_OK(live_stream_init(live_ctx, params));
+			RVAL_OK(live_batch_init(live_ctx, params));
+		}
+		if (params->mode != RUN_DUMMY_MODE &&
+			params->enable_prefetch_flag == IN_SRC_ON) {
+			RVAL_OK(live_prefetch_init(live_ctx, params));
 		}
 	} while (0);
 	return rval;
@@ -603,6 +988,31 @@ void YoloV8_Class::yolov8_thread_join()
 }
 
 cv::Mat YoloV8_Class::Get_img()
+{
+	return Get_img(live_ctx->cur_stream);
+}
+
+ea_tensor_t *YoloV8_Class::live_frame_bgr(int stream)
+{
+	post_thread_ctx_t *thread_ctx = &live_ctx->thread_ctx;
+
+	if (stream < 0 || stream >= live_ctx->stream_num) {
+		stream = 0;
+	}
+	// A predicted frame had no forward pass, its own capture goes with the
+	// extrapolated boxes instead of the last inferred frame.
+	if (live_ctx->stream[stream].frame_predicted &&
+		live_ctx->stream[stream].track_img_set.bgr != NULL) {
+		return live_ctx->stream[stream].track_img_set.bgr;
+	}
+	if (stream > 0) {
+		thread_ctx = live_ctx->stream[stream].thread_ctx;
+	}
+
+	return (ea_tensor_t *)thread_ctx->thread->nn_arm_ctx.bgr;
+}
+
+cv::Mat YoloV8_Class::Get_img(int stream)
 {
 	cv::Mat bgr;
 	int rval;
@@ -611,16 +1021,31 @@ cv::Mat YoloV8_Class::Get_img()
 	// for (int i = 0; i < params->thread_num; i++) 
 	// {
 		cout<<"[Get_img]Start ea_tensor_t *tensor = (ea_tensor_t *)live_ctx->thread_ctx.thread->nn_arm_ctx.bgr"<<endl;
-		if(live_ctx->thread_ctx.thread->nn_arm_ctx.bgr!=NULL)
+		ea_tensor_t *tensor = live_frame_bgr(stream);
+		if(tensor!=NULL)
 		{
-			ea_tensor_t *tensor = (ea_tensor_t *)live_ctx->thread_ctx.thread->nn_arm_ctx.bgr;
 			cout<<"[Get_img]Start tensor2mat_rgb2bgr"<<endl;
+			// reuse a frame buffer the caller is done with instead of
+			// allocating one per frame
+			bgr = frame_pool.acquire(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3],
+				ea_tensor_shape(tensor)[1] == 1 ? CV_8UC1 : CV_8UC3);
 			rval = tensor2mat_bgr2bgr(tensor, bgr);
 			cout<<"[Get_img]End tensor2mat_rgb2bgr"<<endl;
+			if (rval == EA_SUCCESS && params->frame_dump_path && stream <= 0) {
+				if (frame_writer == NULL) {
+					frame_writer = new FrameDatasetWriter(params->frame_dump_path);
+				}
+				if (!frame_writer->write(bgr)) {
+					EA_LOG_ERROR("failed to dump frame to %s\n", params->frame_dump_path);
+				}
+			}
 		}
 		else
 		{
-			bgr = cv::Mat::zeros(1920,1080,CV_8UC3);
+			// 1080p black frame from the pool, cleared on every call since the
+			// caller draws on it
+			bgr = frame_pool.acquire(1080, 1920, CV_8UC3);
+			bgr.setTo(cv::Scalar::all(0));
 		}
 	
 		
@@ -633,6 +1058,31 @@ cv::Mat YoloV8_Class::Get_img()
 }
 
 
+int YoloV8_Class::Get_img_planes(int stream, std::vector<cv::Mat> &planes)
+{
+	int rval = EA_SUCCESS;
+	ea_tensor_t *tensor = NULL;
+
+	do {
+		tensor = live_frame_bgr(stream);
+		if (tensor == NULL) {
+			planes.clear();
+			rval = EA_FAIL;
+			break;
+		}
+		// headers on the tensor planes, valid until the postprocess
+		// writes the next frame into it
+		if (!imgConvert::planarViews((uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU),
+			ea_tensor_pitch(tensor), ea_tensor_shape(tensor)[3],
+			ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[1], planes)) {
+			rval = EA_FAIL;
+		}
+	} while (0);
+
+	return rval;
+}
+
+
 std::vector<BoundingBox> YoloV8_Class::Get_yolov8_Bounding_Boxes(live_ctx_t *live_ctx, live_params_t *params,std::vector<BoundingBox> bboxList)
 {
     //Object obj;
@@ -675,6 +1125,7 @@ std::vector<BoundingBox> YoloV8_Class::Get_yolov8_Bounding_Boxes(live_ctx_t *liv
 									yolov8_result->bbox[i].x_end,
 									yolov8_result->bbox[i].y_end,
 									yolov8_result->bbox[i].id));	
+			bboxList.back().confidence = yolov8_result->bbox[i].score;
 		}
 		printf("Show bboxList ~~~~~~\n");
 		for (int i=0;i<bboxList.size();i++)
@@ -693,7 +1144,17 @@ std::vector<BoundingBox> YoloV8_Class::Get_yolov8_Bounding_Boxes(live_ctx_t *liv
 }
 
 
+int YoloV8_Class::Get_Current_Stream()
+{
+	return live_ctx->cur_stream;
+}
+
 int YoloV8_Class::Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList)
+{
+	return Get_Yolov8_Bounding_Boxes(bboxList, live_ctx->cur_stream);
+}
+
+int YoloV8_Class::Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList, int stream)
 {
 	//Object obj;
 	printf("[Get_Yolov8_Bounding_Boxes]start initial yolov8_result~~~\n");
@@ -701,11 +1162,22 @@ int YoloV8_Class::Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList)
 	// printf("[Get_Yolov8_Bounding_Boxes]End initial yolov8_result~~~\n");
 	cout<<"params->thread_num = "<<params->thread_num<<endl;
 	int j;
+	if (stream < 0 || stream >= live_ctx->stream_num) {
+		EA_LOG_ERROR("stream %d is out of range, stream number is %d\n",
+			stream, live_ctx->stream_num);
+		return false;
+	}
+	post_thread_ctx_t *thread_ctx = live_ctx->stream[stream].thread_ctx;
+	if (live_ctx->stream[stream].frame_predicted) {
+		live_track_update(live_ctx, params, stream, bboxList);
+		return true;
+	}
+	size_t track_start = bboxList.size();
 	for (j = 0; j < params->thread_num; j++) 
 	{
 		// thread = &thread_ctx->thread[i];
 		// yolov8_result_t *yolov8_result = (yolov8_result_t *)live_ctx->thread_ctx.thread->nn_arm_ctx.result;
-		yolov8_result_t *yolov8_result = (yolov8_result_t *)live_ctx->thread_ctx.thread[j].nn_arm_ctx.result;
+		yolov8_result_t *yolov8_result = (yolov8_result_t *)thread_ctx->thread[j].nn_arm_ctx.result;
 		int i = 0;
 		cout<<"yolov8_result->num = "<<yolov8_result->num<<endl;
 		for ( i = 0; i < yolov8_result->num; i++)
@@ -735,6 +1207,7 @@ int YoloV8_Class::Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList)
 									yolov8_result->bbox[i].x_end,
 									yolov8_result->bbox[i].y_end,
 									yolov8_result->bbox[i].id));
+			bboxList.back().confidence = yolov8_result->bbox[i].score;
 
 		}
 		printf("[Get_Yolov8_Bounding_Boxes]print BB~~~~~~~~~~~~~~~~~~\n");
@@ -747,6 +1220,11 @@ int YoloV8_Class::Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList)
 											bboxList[i].y2,
 											bboxList[i].label);
 			}
+	}
+	if ((params->mode == RUN_LIVE_MODE || params->replay_output_path) &&
+		params->track_interval > 1) {
+		std::vector<BoundingBox> detList(bboxList.begin() + track_start, bboxList.end());
+		live_track_update(live_ctx, params, stream, detList);
 	}
 		return true;
 }
@@ -755,31 +1233,18 @@ int YoloV8_Class::Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList)
 int YoloV8_Class::tensor2mat_bgr2bgr(ea_tensor_t *tensor, cv::Mat &bgr)
 {
 	int rval = EA_SUCCESS;
-	void *c1_data = ea_tensor_data_for_read(tensor, EA_CPU);
-	void *c2_data = (uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU) + ea_tensor_shape(tensor)[2] * ea_tensor_pitch(tensor);
-	void *c3_data = (uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU) + ea_tensor_shape(tensor)[2] * ea_tensor_pitch(tensor) * 2;
-	cv::Mat c1(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3], CV_8UC1, c1_data, ea_tensor_pitch(tensor));
-	cv::Mat c2(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3], CV_8UC1, c2_data, ea_tensor_pitch(tensor));
-	cv::Mat c3(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3], CV_8UC1, c3_data, ea_tensor_pitch(tensor));
-	std::vector<cv::Mat> channels;
 
 	do {
-		if (ea_tensor_shape(tensor)[1] == 1) {
-			channels.push_back(c1);
-		}
-		else if (ea_tensor_shape(tensor)[1] == 3)
-		{
-			channels.push_back(c1);
-			channels.push_back(c2);
-			channels.push_back(c3);
-		}
-		else {
+		if (ea_tensor_shape(tensor)[1] != 1 && ea_tensor_shape(tensor)[1] != 3) {
 			EA_LOG_ERROR("channel number %lu is not 1 or 3 for saving to jpeg\n", ea_tensor_shape(tensor)[1]);
 			rval = EA_FAIL;
 			break;
 		}
 
-		cv::merge(channels, bgr);
+		// bgr is written in place when it already has the tensor shape
+		imgConvert::planarToMat((const uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU),
+			ea_tensor_pitch(tensor), ea_tensor_shape(tensor)[3],
+			ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[1], bgr);
 	} while (0);
 
 	return rval;
@@ -789,32 +1254,19 @@ int YoloV8_Class::tensor2mat_bgr2bgr(ea_tensor_t *tensor, cv::Mat &bgr)
 int YoloV8_Class::tensor2mat_rgb2bgr(ea_tensor_t *tensor, cv::Mat &bgr)
 {
 	int rval = EA_SUCCESS;
-	void *c1_data = ea_tensor_data_for_read(tensor, EA_CPU);
-	void *c2_data = (uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU) + ea_tensor_shape(tensor)[2] * ea_tensor_pitch(tensor);
-	void *c3_data = (uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU) + ea_tensor_shape(tensor)[2] * ea_tensor_pitch(tensor) * 2;
-	cv::Mat c1(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3], CV_8UC1, c1_data, ea_tensor_pitch(tensor));
-	cv::Mat c2(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3], CV_8UC1, c2_data, ea_tensor_pitch(tensor));
-	cv::Mat c3(ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[3], CV_8UC1, c3_data, ea_tensor_pitch(tensor));
-	std::vector<cv::Mat> channels;
 
 	do {
-		if (ea_tensor_shape(tensor)[1] == 1) {
-			channels.push_back(c1);
-		}
-		else if (ea_tensor_shape(tensor)[1] == 3)
-		{
-			channels.push_back(c1);
-			channels.push_back(c2);
-			channels.push_back(c3);
-		}
-		else {
+		if (ea_tensor_shape(tensor)[1] != 1 && ea_tensor_shape(tensor)[1] != 3) {
 			EA_LOG_ERROR("channel number is not 1 or 3 for saving to jpeg\n");
 			rval = EA_FAIL;
 			break;
 		}
 
-		std::swap(channels[0], channels[2]);
-		cv::merge(channels, bgr);
+		// R and B are swapped while interleaving, bgr is written in place
+		// when it already has the tensor shape
+		imgConvert::planarToMat((const uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU),
+			ea_tensor_pitch(tensor), ea_tensor_shape(tensor)[3],
+			ea_tensor_shape(tensor)[2], ea_tensor_shape(tensor)[1], bgr, true);
 	} while (0);
 
 	return rval;
@@ -823,38 +1275,25 @@ int YoloV8_Class::tensor2mat_rgb2bgr(ea_tensor_t *tensor, cv::Mat &bgr)
 int YoloV8_Class::tensor2mat_yuv2bgr_nv12(ea_tensor_t *tensor, cv::Mat &bgr)
 {
 	int rval = EA_SUCCESS;
-	cv::Mat nv12(ea_tensor_shape(tensor)[2] +
-		(ea_tensor_related(tensor) == NULL ? 0 : ea_tensor_shape(ea_tensor_related(tensor))[2]),
-		ea_tensor_shape(tensor)[3], CV_8UC1);
-	uint8_t *p_src = NULL;
-	uint8_t *p_dst = NULL;
-	size_t h;
+	ea_tensor_t *uv = NULL;
 
 	do {
 		EA_R_ASSERT(ea_tensor_shape(tensor)[1] == 1);
-
-		p_src = (uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU);
-		p_dst = nv12.data;
-		for (h = 0; h < ea_tensor_shape(tensor)[2]; h++) {
-			memcpy(p_dst, p_src, ea_tensor_shape(tensor)[3]);
-			p_src += ea_tensor_pitch(tensor);
-			p_dst += ea_tensor_shape(tensor)[3];
+		uv = ea_tensor_related(tensor);
+		if (uv == NULL) {
+			EA_LOG_ERROR("NV12 tensor has no UV plane\n");
+			rval = EA_FAIL;
+			break;
 		}
 
-		if (ea_tensor_related(tensor)) {
-			p_src = (uint8_t *)ea_tensor_data_for_read(ea_tensor_related(tensor), EA_CPU);
-			for (h = 0; h < ea_tensor_shape(ea_tensor_related(tensor))[2]; h++) {
-				memcpy(p_dst, p_src, ea_tensor_shape(ea_tensor_related(tensor))[3]);
-				p_src += ea_tensor_pitch(ea_tensor_related(tensor));
-				p_dst += ea_tensor_shape(ea_tensor_related(tensor))[3];
-			}
+		// Y and UV are read in place with their own pitch
+		if (!nv12_converter.convert(
+			(const uint8_t *)ea_tensor_data_for_read(tensor, EA_CPU), ea_tensor_pitch(tensor),
+			(const uint8_t *)ea_tensor_data_for_read(uv, EA_CPU), ea_tensor_pitch(uv),
+			ea_tensor_shape(tensor)[3], ea_tensor_shape(tensor)[2], bgr)) {
+			rval = EA_FAIL;
+			break;
 		}
-
-		#if CV_VERSION_MAJOR < 4
-			cv::cvtColor(nv12, bgr, CV_YUV2BGR_NV12);
-		#else
-			cv::cvtColor(nv12, bgr, cv::COLOR_YUV2BGR_NV12);
-		#endif
 	} while (0);
 
 	return rval;
@@ -993,6 +1432,10 @@ void YoloV8_Class::cv_env_deinit(live_ctx_t *live_ctx)
 
 void YoloV8_Class::live_deinit(live_ctx_t *live_ctx, live_params_t *params)
 {
+	live_prefetch_deinit(live_ctx);
+	live_record_deinit();
+	live_batch_deinit(live_ctx);
+	live_stream_deinit(live_ctx);
 	post_thread_deinit(&live_ctx->thread_ctx, &live_ctx->nn_cvflow);
 	nn_cvflow_deinit(&live_ctx->nn_cvflow);
 	cv_env_deinit(live_ctx);
@@ -1004,6 +1447,10 @@ void YoloV8_Class::live_deinit(live_ctx_t *live_ctx, live_params_t *params)
 
 void YoloV8_Class::test_yolov8_deinit()
 {
+	live_prefetch_deinit(live_ctx);
+	live_record_deinit();
+	live_batch_deinit(live_ctx);
+	live_stream_deinit(live_ctx);
 		post_thread_deinit( &live_ctx->thread_ctx, &YoloV8_Class::live_ctx->nn_cvflow);
 	nn_cvflow_deinit(&live_ctx->nn_cvflow);
 	cv_env_deinit(live_ctx);
@@ -1014,6 +1461,10 @@ void YoloV8_Class::test_yolov8_deinit()
 };
 
 void YoloV8_Class::test_yolov8_deinit(live_ctx_t *live_ctx, live_params_t *params){
+	live_prefetch_deinit(live_ctx);
+	live_record_deinit();
+	live_batch_deinit(live_ctx);
+	live_stream_deinit(live_ctx);
 	post_thread_deinit(&live_ctx->thread_ctx, &live_ctx->nn_cvflow);
 	nn_cvflow_deinit(&live_ctx->nn_cvflow);
 	cv_env_deinit(live_ctx);
@@ -1024,14 +1475,14 @@ void YoloV8_Class::test_yolov8_deinit(live_ctx_t *live_ctx, live_params_t *param
 };
 
 int YoloV8_Class::live_update_net_output(live_ctx_t *live_ctx,
-	vp_output_t **vp_output)
+	post_thread_ctx_t *thread_ctx, vp_output_t **vp_output)
 {
 	int rval = EA_SUCCESS;
 	ea_queue_t *queue = NULL;
 	int i;
 	vp_output_t *tmp;
 	do {
-		queue = post_thread_queue(&live_ctx->thread_ctx);
+		queue = post_thread_queue(thread_ctx);
 		*vp_output = (vp_output_t *)ea_queue_request_carrier(queue);
 		RVAL_ASSERT(*vp_output != NULL);
 		tmp = *vp_output;
@@ -1044,108 +1495,371 @@ int YoloV8_Class::live_update_net_output(live_ctx_t *live_ctx,
 	return rval;
 };
 
-int YoloV8_Class::live_run_loop_dummy(live_ctx_t *live_ctx, live_params_t *params)
+int YoloV8_Class::live_declare_output_usage(live_ctx_t *live_ctx,
+	live_params_t *params)
 {
 	int rval = EA_SUCCESS;
-	ea_calc_fps_ctx_t calc_fps_ctx;
-	float fps;
-	ea_img_resource_data_t data;
-	memset(&calc_fps_ctx, 0, sizeof(ea_calc_fps_ctx_t));
-	calc_fps_ctx.count_period = DEFAULT_FPS_COUNT_PERIOD;
-	int i;
-	nn_input_ops_type_t *ops = NULL;
+	lua_State *L = NULL;
 
+	memset(&live_ctx->arm_cfg, 0, sizeof(yolov8_arm_cfg_t));
+	live_ctx->sync_all_outputs = 1;
 	do {
-		RVAL_ASSERT(live_ctx != NULL);
-		ops = live_ctx->nn_input_ctx.ops;
-		RVAL_ASSERT(ops->nn_input_hold_data != NULL);
-
-		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
-			RVAL_OK(ops->nn_input_hold_data(&live_ctx->nn_input_ctx,
-				i, nn_cvflow_input(&live_ctx->nn_cvflow, i), &data));
+		// Only the yolov8 postprocess declares which outputs it reads,
+		// the others (to_file for example) consume every output, and so
+		// does the recorder.
+		if (params->record_output_path != NULL || params->arm_nn_name == NULL || params->lua_file_path == NULL ||
+			strcmp(params->arm_nn_name, YOLOV8_POSTPROCESS_NAME) != 0) {
+			break;
 		}
-
-		do {
-			EA_MEASURE_TIME_START();
-			RVAL_OK(nn_cvflow_inference(&live_ctx->nn_cvflow));
-			EA_MEASURE_TIME_END("network forward time: ");
-			fps = ea_calc_fps(&calc_fps_ctx);
-			if (fps > 0) {
-				EA_LOG_NOTICE("fps %.1f\n", fps);
-			}
-		} while (live_ctx->sig_flag == 0);
-
-		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
-			RVAL_OK(ops->nn_input_release_data(&live_ctx->nn_input_ctx,
-			&data, i));
+		L = luaL_newstate();
+		RVAL_ASSERT(L != NULL);
+		luaL_openlibs(L);
+		if (luaL_dofile(L, params->lua_file_path) != LUA_OK) {
+			EA_LOG_NOTICE("can't parse %s (%s), sync all network outputs\n",
+				params->lua_file_path, lua_tostring(L, -1));
+			break;
+		}
+		lua_pushglobaltable(L);
+		if (live_lua_find_arm_cfg(L, 2, &live_ctx->arm_cfg) &&
+			live_ctx->arm_cfg.output_0[0] != '\0') {
+			live_ctx->sync_all_outputs = 0;
+			EA_LOG_NOTICE("sync network output %s%s%s only\n",
+				live_ctx->arm_cfg.output_0,
+				live_ctx->arm_cfg.enable_seg ? " and " : "",
+				live_ctx->arm_cfg.enable_seg ? live_ctx->arm_cfg.output_1 : "");
 		}
 	} while (0);
+	if (L) {
+		lua_close(L);
+	}
 
-	//return rval;
-	return live_ctx->sig_flag;
+	return rval;
 };
 
-int YoloV8_Class::live_convert_yuv_data_to_bgr_data_for_postprocess(live_params_t *params, img_set_t *img_set)
+int YoloV8_Class::live_output_synced(live_ctx_t *live_ctx,
+	const char *tensor_name)
+{
+	return live_ctx->sync_all_outputs ||
+		strcmp(tensor_name, live_ctx->arm_cfg.output_0) == 0 ||
+		(live_ctx->arm_cfg.enable_seg &&
+		strcmp(tensor_name, live_ctx->arm_cfg.output_1) == 0);
+};
+
+int YoloV8_Class::live_sync_net_output(live_ctx_t *live_ctx,
+	vp_output_t *vp_output)
 {
 	int rval = EA_SUCCESS;
-	size_t shape[EA_DIM] = {0};
-	int img_src_id = 0;
+	const char *missing = NULL;
+	int i;
 
 	do {
-		if (params->use_pyramid == IN_SRC_ON) {
-			img_src_id = params->pyramid[1];
+		// Every declared output has to be one of the network, otherwise the
+		// postprocess would read it without a sync.
+		if (!live_ctx->sync_all_outputs) {
+			if (live_output_index(vp_output, live_ctx->arm_cfg.output_0) < 0) {
+				missing = live_ctx->arm_cfg.output_0;
+			} else if (live_ctx->arm_cfg.enable_seg &&
+				live_output_index(vp_output, live_ctx->arm_cfg.output_1) < 0) {
+				missing = live_ctx->arm_cfg.output_1;
+			}
+			if (missing != NULL) {
+				EA_LOG_ERROR("output \"%s\" is not found in network, sync all network outputs\n",
+					missing);
+				live_ctx->sync_all_outputs = 1;
+			}
 		}
-
-		if (img_set->bgr == NULL) {
-			shape[EA_N] = ea_tensor_shape(img_set->img[0].tensor_group[img_src_id])[EA_N];
-			shape[EA_C] = 3;
-			shape[EA_H] = ea_tensor_shape(img_set->img[0].tensor_group[img_src_id])[EA_H];
-			shape[EA_W] = ea_tensor_shape(img_set->img[0].tensor_group[img_src_id])[EA_W];
-			if (ea_tensor_related(img_set->img[0].tensor_group[img_src_id]) == NULL) {
-				shape[EA_H] = shape[EA_H] * 2 / 3;
+		for (i = 0; i < vp_output->out_num; i++) {
+			if (!live_output_synced(live_ctx, vp_output->out[i].tensor_name)) {
+				continue;
 			}
-			img_set->bgr = ea_tensor_new(EA_U8, shape, 0);
-			RVAL_ASSERT(img_set->bgr != NULL);
+			RVAL_OK(ea_tensor_sync_cache(vp_output->out[i].out, EA_VP, EA_CPU));
 		}
-		RVAL_OK(ea_cvt_color_resize(img_set->img[0].tensor_group[img_src_id],
-			img_set->bgr, EA_COLOR_YUV2BGR_NV12, EA_VP));
 	} while (0);
 
 	return rval;
 };
 
-int YoloV8_Class::live_run_loop_without_dummy(live_ctx_t *live_ctx, 
-                                        live_params_t *params)
+int YoloV8_Class::live_output_index(vp_output_t *vp_output, const char *tensor_name)
 {
-	int rval = EA_SUCCESS;
-	int i = 0;
-	ea_calc_fps_ctx_t calc_fps_ctx;
-	float fps;
-	ea_queue_t *queue = NULL;
-	vp_output_t *vp_output = NULL;
-	calc_fps_ctx.count_period = DEFAULT_FPS_COUNT_PERIOD;
-	img_set_t *img_set;
-	nn_input_ops_type_t *ops = NULL;
+	int i;
+
+	for (i = 0; i < vp_output->out_num; i++) {
+		if (strcmp(vp_output->out[i].tensor_name, tensor_name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+};
+
+int YoloV8_Class::live_record_net_output(live_ctx_t *live_ctx,
+	live_params_t *params, int stream_idx, uint64_t seq, uint64_t timestamp_us,
+	vp_output_t *vp_output)
+{
+	int rval = EA_SUCCESS;
+	ea_tensor_t *tensor = NULL;
+	size_t *shape = NULL;
+	uint32_t in_shape[EA_DIM];
+	uint32_t out_shape[EA_DIM];
+	int i, j;
+
+	do {
+		if (params->record_output_path == NULL) {
+			break;
+		}
+		if (tensor_recorder == NULL) {
+			tensor_recorder = new TensorRecordWriter(params->record_output_path,
+				params->record_compress_flag == IN_SRC_ON);
+		}
+		shape = ea_tensor_shape(nn_cvflow_input(&live_ctx->nn_cvflow, 0));
+		for (j = 0; j < EA_DIM; j++) {
+			in_shape[j] = shape[j];
+		}
+		RVAL_ASSERT(tensor_recorder->beginFrame(seq, timestamp_us, in_shape, stream_idx));
+		for (i = 0; i < vp_output->out_num; i++) {
+			tensor = vp_output->out[i].out;
+			shape = ea_tensor_shape(tensor);
+			for (j = 0; j < EA_DIM; j++) {
+				out_shape[j] = shape[j];
+			}
+			// outputs are synced to CPU by live_sync_net_output
+			RVAL_ASSERT(tensor_recorder->addTensor(vp_output->out[i].tensor_name,
+				ea_tensor_dtype(tensor), out_shape, ea_tensor_pitch(tensor),
+				ea_tensor_data_for_read(tensor, EA_CPU), ea_tensor_size(tensor)));
+		}
+		RVAL_BREAK();
+		RVAL_ASSERT(tensor_recorder->endFrame());
+	} while (0);
+
+	if (rval != EA_SUCCESS) {
+		EA_LOG_ERROR("failed to record network output to %s\n", params->record_output_path);
+	}
+
+	return rval;
+};
+
+void YoloV8_Class::live_record_deinit()
+{
+	if (tensor_recorder == NULL) {
+		return;
+	}
+	tensor_recorder->close();
+	EA_LOG_NOTICE("recorded %llu frames, %.1f MB of outputs in %.1f MB\n",
+		(unsigned long long)tensor_recorder->getFrameCount(),
+		tensor_recorder->getRawBytes() / 1048576.0,
+		tensor_recorder->getStoredBytes() / 1048576.0);
+	delete tensor_recorder;
+	tensor_recorder = NULL;
+};
+
+int YoloV8_Class::live_run_loop_replay(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	live_stream_ctx_t *stream = NULL;
+	vp_output_t *vp_output = NULL;
+	img_set_t *img_set = NULL;
+	const RecordedTensor *recorded = NULL;
+	ea_tensor_t *out = NULL;
+	int i;
+
+	do {
+		if (tensor_replayer == NULL) {
+			tensor_replayer = new TensorRecordReader();
+			RVAL_ASSERT(tensor_replayer->open(params->replay_output_path));
+		}
+		if (replay_pending == 0) {
+			if (!tensor_replayer->next(replay_frame)) {
+				EA_LOG_NOTICE("All recorded frames are handled\n");
+				live_ctx->sig_flag = 1;
+				break;
+			}
+			replay_pending = 1;
+		}
+		RVAL_ASSERT(replay_frame.header.stream < (uint32_t)live_ctx->stream_num);
+		live_ctx->cur_stream = replay_frame.header.stream;
+		stream = &live_ctx->stream[live_ctx->cur_stream];
+
+		// The recording keeps the capture frame number of every forward, the
+		// frames in between were predicted by the tracker and are again.
+		stream->track_frame++;
+		stream->frame_predicted = 0;
+		if (params->track_interval > 1 &&
+			(uint64_t)stream->track_frame < replay_frame.header.seq) {
+			stream->frame_predicted = 1;
+			break;
+		}
+		stream->track_frame = replay_frame.header.seq;
+		replay_pending = 0;
+
+		// The outputs go through the carrier as after a forward, the arm
+		// postprocess reads them from CPU.
+		RVAL_OK(live_update_net_output(live_ctx, stream->thread_ctx, &vp_output));
+		for (i = 0; i < vp_output->out_num; i++) {
+			out = vp_output->out[i].out;
+			recorded = replay_frame.find(vp_output->out[i].tensor_name);
+			if (recorded == NULL || recorded->desc.size != ea_tensor_size(out) ||
+				recorded->desc.dtype != (uint32_t)ea_tensor_dtype(out)) {
+				EA_LOG_ERROR("output %s doesn't match the recording\n",
+					vp_output->out[i].tensor_name);
+				rval = EA_FAIL;
+				break;
+			}
+			memcpy(ea_tensor_data_for_write(out, EA_CPU), recorded->data,
+				recorded->desc.size);
+		}
+		RVAL_BREAK();
+		img_set = post_thread_get_img_set(stream->thread_ctx, stream->seq);
+		stream->seq++;
+		// no frame was held, there is nothing to draw on or release
+		memset(img_set->img, 0, sizeof(img_set->img));
+		vp_output->arg = img_set;
+		RVAL_OK(ea_queue_en(post_thread_queue(stream->thread_ctx), vp_output));
+	} while (0);
+
+	if (rval != EA_SUCCESS) {
+		live_ctx->sig_flag = 1;
+	}
+
+	return live_ctx->sig_flag;
+};
+
+int YoloV8_Class::live_run_loop_dummy(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	ea_calc_fps_ctx_t calc_fps_ctx;
+	float fps;
+	ea_img_resource_data_t data;
 	memset(&calc_fps_ctx, 0, sizeof(ea_calc_fps_ctx_t));
-	int fps_notice_flag = 0;
+	calc_fps_ctx.count_period = DEFAULT_FPS_COUNT_PERIOD;
+	int i;
+	nn_input_ops_type_t *ops = NULL;
+
 	do {
 		RVAL_ASSERT(live_ctx != NULL);
 		ops = live_ctx->nn_input_ctx.ops;
 		RVAL_ASSERT(ops->nn_input_hold_data != NULL);
-		RVAL_OK(YoloV8_Class::live_update_net_output(live_ctx, &vp_output));
-		img_set = post_thread_get_img_set(&live_ctx->thread_ctx, live_ctx->seq);
-		live_ctx->seq++;
+
 		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
 			RVAL_OK(ops->nn_input_hold_data(&live_ctx->nn_input_ctx,
+				i, nn_cvflow_input(&live_ctx->nn_cvflow, i), &data));
+		}
+
+		do {
+			EA_MEASURE_TIME_START();
+			RVAL_OK(nn_cvflow_inference(&live_ctx->nn_cvflow));
+			EA_MEASURE_TIME_END("network forward time: ");
+			fps = ea_calc_fps(&calc_fps_ctx);
+			if (fps > 0) {
+				EA_LOG_NOTICE("fps %.1f\n", fps);
+			}
+		} while (live_ctx->sig_flag == 0);
+
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			RVAL_OK(ops->nn_input_release_data(&live_ctx->nn_input_ctx,
+			&data, i));
+		}
+	} while (0);
+
+	//return rval;
+	return live_ctx->sig_flag;
+};
+
+int YoloV8_Class::live_convert_yuv_data_to_bgr_data_for_postprocess(live_params_t *params, img_set_t *img_set)
+{
+	int rval = EA_SUCCESS;
+	size_t shape[EA_DIM] = {0};
+	int img_src_id = 0;
+
+	do {
+		if (params->use_pyramid == IN_SRC_ON) {
+			img_src_id = params->pyramid[1];
+		}
+
+		if (img_set->bgr == NULL) {
+			shape[EA_N] = ea_tensor_shape(img_set->img[0].tensor_group[img_src_id])[EA_N];
+			shape[EA_C] = 3;
+			shape[EA_H] = ea_tensor_shape(img_set->img[0].tensor_group[img_src_id])[EA_H];
+			shape[EA_W] = ea_tensor_shape(img_set->img[0].tensor_group[img_src_id])[EA_W];
+			if (ea_tensor_related(img_set->img[0].tensor_group[img_src_id]) == NULL) {
+				shape[EA_H] = shape[EA_H] * 2 / 3;
+			}
+			img_set->bgr = ea_tensor_new(EA_U8, shape, 0);
+			RVAL_ASSERT(img_set->bgr != NULL);
+		}
+		RVAL_OK(ea_cvt_color_resize(img_set->img[0].tensor_group[img_src_id],
+			img_set->bgr, EA_COLOR_YUV2BGR_NV12, EA_VP));
+	} while (0);
+
+	return rval;
+};
+
+int YoloV8_Class::live_run_loop_without_dummy(live_ctx_t *live_ctx, 
+                                        live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	int i = 0;
+	float fps;
+	ea_queue_t *queue = NULL;
+	vp_output_t *vp_output = NULL;
+	img_set_t *img_set;
+	nn_input_ops_type_t *ops = NULL;
+	live_stream_ctx_t *stream = NULL;
+	uint64_t hold_start_us;
+	int fps_notice_flag = 0;
+	int stream_idx;
+
+	if (params->replay_output_path) {
+		return live_run_loop_replay(live_ctx, params);
+	}
+	if (live_ctx->batch.enable) {
+		return live_run_loop_batch(live_ctx, params);
+	}
+	stream_idx = live_stream_schedule(live_ctx);
+	if (stream_idx < 0) {
+		live_ctx->sig_flag = 1;
+		return live_ctx->sig_flag;
+	}
+	live_ctx->cur_stream = stream_idx;
+	stream = &live_ctx->stream[stream_idx];
+	stream->track_frame++;
+	stream->frame_predicted = 0;
+	if (params->mode == RUN_LIVE_MODE && params->track_interval > 1 &&
+		stream->track_skip_left > 0) {
+		stream->track_skip_left--;
+		stream->frame_predicted = 1;
+		return live_run_loop_track(live_ctx, params, stream);
+	}
+	if (live_ctx->prefetch.thread_created) {
+		return live_run_loop_prefetch(live_ctx, params);
+	}
+	do {
+		RVAL_ASSERT(live_ctx != NULL);
+		ops = stream->input_ctx->ops;
+		RVAL_ASSERT(ops->nn_input_hold_data != NULL);
+		RVAL_OK(YoloV8_Class::live_update_net_output(live_ctx,
+			stream->thread_ctx, &vp_output));
+		img_set = post_thread_get_img_set(stream->thread_ctx, stream->seq);
+		stream->seq++;
+		hold_start_us = live_get_time_us();
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			RVAL_OK(ops->nn_input_hold_data(stream->input_ctx,
 				i, nn_cvflow_input(&live_ctx->nn_cvflow, i), &(img_set->img[i])));
 			if (img_set->img[i].tensor_group == NULL) {
-				EA_LOG_NOTICE("All files are handled\n");
-				live_ctx->sig_flag = 1;
+				stream->eof = 1;
 				break;
 			}
 		}
 		RVAL_BREAK();
-		if (live_ctx->sig_flag) {
+		if (stream->eof) {
+			for (i = 0; i < live_ctx->stream_num; i++) {
+				if (live_ctx->stream[i].eof == 0) {
+					break;
+				}
+			}
+			if (i == live_ctx->stream_num) {
+				EA_LOG_NOTICE("All files are handled\n");
+				live_ctx->sig_flag = 1;
+			}
 			break;
 		}
 		if (params->mode == RUN_LIVE_MODE &&
@@ -1161,27 +1875,950 @@ int YoloV8_Class::live_run_loop_without_dummy(live_ctx_t *live_ctx,
 			live_ctx->loop_count = INTERVAL_PRINT_PROCESS_TIME;
 		}
 		if (params->mode == RUN_LIVE_MODE) {
-			fps = ea_calc_fps(&calc_fps_ctx);
+			fps = ea_calc_fps(&stream->calc_fps_ctx);
 			if (fps > 0) {
 				if (fps_notice_flag == 0) {
 					EA_LOG_NOTICE("!!! FPS based on frame query, preprocess, and inference.");
 					fps_notice_flag = 1;
 				}
-				EA_LOG_NOTICE("fps %.1f\n", fps);
+				if (live_ctx->stream_num > 1) {
+					EA_LOG_NOTICE("canvas %d fps %.1f\n", stream->canvas_id, fps);
+				} else {
+					EA_LOG_NOTICE("fps %.1f\n", fps);
+				}
 			}
 		}
-		for (i = 0; i < vp_output->out_num; i++) {
-			RVAL_OK(ea_tensor_sync_cache(vp_output->out[i].out, EA_VP, EA_CPU));
+		RVAL_OK(live_sync_net_output(live_ctx, vp_output));
+		RVAL_OK(live_record_net_output(live_ctx, params, stream_idx,
+			stream->track_frame, hold_start_us, vp_output));
+		queue = post_thread_queue(stream->thread_ctx);
+		RVAL_OK(ea_queue_en(queue, vp_output));
+		live_stream_stat(live_ctx, stream, live_get_time_us() - hold_start_us);
+	} while (0);
+
+	// return rval;
+	return live_ctx->sig_flag;
+};
+
+int YoloV8_Class::live_batch_init(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	live_batch_ctx_t *batch = &live_ctx->batch;
+	ea_tensor_t *input = NULL;
+	size_t shape[EA_DIM] = {0};
+	int net_batch;
+	int i;
+
+	do {
+		batch->pending_stream = -1;
+		if ((params->batch_window_ms <= 0 || live_ctx->stream_num < 2) &&
+			params->file_batch_flag != IN_SRC_ON) {
+			break;
+		}
+		net_batch = ea_tensor_shape(nn_cvflow_input(&live_ctx->nn_cvflow, 0))[EA_N];
+		if (net_batch < 2) {
+			EA_LOG_NOTICE("network batch is %d, micro-batching is disabled\n", net_batch);
+			break;
+		}
+		RVAL_ASSERT(live_ctx->nn_cvflow.in_num <= NN_MAX_PORT_NUM);
+		if (net_batch > LIVE_MAX_BATCH_NUM) {
+			EA_LOG_NOTICE("network batch is %d, only %d slices are used\n",
+				net_batch, LIVE_MAX_BATCH_NUM);
+		}
+		if (params->file_batch_flag == IN_SRC_ON) {
+			// consecutive files of the one input, the batch is always filled
+			batch->batch_size = net_batch < LIVE_MAX_BATCH_NUM ?
+				net_batch : LIVE_MAX_BATCH_NUM;
+			batch->window_us = 0;
+			batch->one_per_stream = 0;
+			// Every image of a batch holds a carrier and an image set of the
+			// one post thread until the forward, both rings are queue_size.
+			if (params->queue_size < batch->batch_size) {
+				EA_LOG_ERROR("file batch of %d images needs a queue size >= %d, got %d\n",
+					batch->batch_size, batch->batch_size, params->queue_size);
+				rval = EA_FAIL;
+				break;
+			}
+		} else {
+			batch->batch_size = net_batch < live_ctx->stream_num ?
+				net_batch : live_ctx->stream_num;
+			batch->window_us = (uint64_t)(params->batch_window_ms * 1000);
+			batch->one_per_stream = 1;
+		}
+
+		// Frames are held into a one frame tensor and copied to their slice.
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			input = nn_cvflow_input(&live_ctx->nn_cvflow, i);
+			RVAL_ASSERT((int)ea_tensor_shape(input)[EA_N] == net_batch);
+			memcpy(shape, ea_tensor_shape(input), sizeof(shape));
+			shape[EA_N] = 1;
+			batch->input[i] = ea_tensor_new(ea_tensor_dtype(input), shape,
+				ea_tensor_pitch(input));
+			RVAL_ASSERT(batch->input[i] != NULL);
+			batch->input_slice[i] = ea_tensor_size(input) / net_batch;
 		}
 		RVAL_BREAK();
+		batch->enable = 1;
+		if (params->file_batch_flag == IN_SRC_ON) {
+			EA_LOG_NOTICE("file batch: %d images per forward\n", batch->batch_size);
+		} else {
+			EA_LOG_NOTICE("micro-batching: up to %d frames in %.1f ms\n",
+				batch->batch_size, params->batch_window_ms);
+		}
+	} while (0);
+
+	return rval;
+};
+
+void YoloV8_Class::live_batch_deinit(live_ctx_t *live_ctx)
+{
+	live_batch_ctx_t *batch = &live_ctx->batch;
+	int i;
+
+	for (i = 0; i < NN_MAX_PORT_NUM; i++) {
+		if (batch->input[i]) {
+			ea_tensor_free(batch->input[i]);
+			batch->input[i] = NULL;
+		}
+	}
+	batch->enable = 0;
+};
+
+int YoloV8_Class::live_batch_fill_slice(live_ctx_t *live_ctx,
+	ea_tensor_t **src, int slice_idx)
+{
+	int rval = EA_SUCCESS;
+	live_batch_ctx_t *batch = &live_ctx->batch;
+	ea_tensor_t *input = NULL;
+	int i;
+
+	do {
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			input = nn_cvflow_input(&live_ctx->nn_cvflow, i);
+			RVAL_ASSERT(ea_tensor_size(src[i]) >= batch->input_slice[i]);
+			RVAL_OK(ea_tensor_sync_cache(src[i], EA_VP, EA_CPU));
+			memcpy((uint8_t *)ea_tensor_data_for_write(input, EA_CPU) +
+				slice_idx * batch->input_slice[i],
+				ea_tensor_data_for_read(src[i], EA_CPU),
+				batch->input_slice[i]);
+		}
+	} while (0);
+
+	return rval;
+};
+
+int YoloV8_Class::live_batch_split_output(live_ctx_t *live_ctx,
+	vp_output_t *src, vp_output_t *dst, int slice_idx)
+{
+	int rval = EA_SUCCESS;
+	ea_tensor_t *out = NULL;
+	size_t slice;
+	int i;
+
+	do {
+		dst->out_num = src->out_num;
+		for (i = 0; i < src->out_num; i++) {
+			// the others were not synced to CPU, nobody reads them
+			if (!live_output_synced(live_ctx, src->out[i].tensor_name)) {
+				continue;
+			}
+			out = src->out[i].out;
+			slice = ea_tensor_size(out) / ea_tensor_shape(out)[EA_N];
+			RVAL_ASSERT(ea_tensor_size(dst->out[i].out) >= slice);
+			memcpy(ea_tensor_data_for_write(dst->out[i].out, EA_CPU),
+				(uint8_t *)ea_tensor_data_for_read(out, EA_CPU) + slice_idx * slice,
+				slice);
+		}
+	} while (0);
+
+	return rval;
+};
+
+uint64_t YoloV8_Class::live_batch_budget(live_ctx_t *live_ctx,
+	live_params_t *params, uint64_t start_us, const uint64_t *hold_start_us,
+	const int *slot_stream, int batch_num, int *slo_bound)
+{
+	live_batch_ctx_t *batch = &live_ctx->batch;
+	uint64_t now_us = live_get_time_us();
+	uint64_t budget_us = UINT64_MAX;
+	uint64_t used_us;
+	uint64_t slo_us;
+	int k;
+
+	// Time left to wait for one more frame before the window closes or a
+	// frame already in the batch would miss its SLO.
+	*slo_bound = 0;
+	if (batch->window_us > 0) {
+		used_us = now_us - start_us;
+		budget_us = used_us < batch->window_us ? batch->window_us - used_us : 0;
+	}
+	for (k = 0; k < batch_num; k++) {
+		slo_us = (uint64_t)(params->latency_slo_ms[slot_stream[k]] * 1000);
+		if (slo_us == 0) {
+			continue;
+		}
+		used_us = now_us - hold_start_us[k] + batch->forward_us;
+		if (used_us >= slo_us) {
+			*slo_bound = 1;
+			return 0;
+		}
+		if (slo_us - used_us < budget_us) {
+			budget_us = slo_us - used_us;
+			*slo_bound = 1;
+		}
+	}
+
+	return budget_us;
+};
+
+int YoloV8_Class::live_run_loop_batch(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	live_batch_ctx_t *batch = &live_ctx->batch;
+	live_stream_ctx_t *stream = NULL;
+	nn_input_ops_type_t *ops = NULL;
+	vp_output_t *vp_output[LIVE_MAX_BATCH_NUM];
+	img_set_t *img_set[LIVE_MAX_BATCH_NUM];
+	ea_img_resource_data_t data[NN_MAX_PORT_NUM];
+	int slot_stream[LIVE_MAX_BATCH_NUM];
+	uint64_t hold_start_us[LIVE_MAX_BATCH_NUM];
+	uint64_t start_us, forward_us;
+	uint64_t latency_us, slo_us;
+	uint64_t wait_us;
+	uint64_t commit_start_us;
+	uint64_t budget_us;
+	live_prefetch_slot_t *slot = NULL;
+	ea_tensor_t *bgr = NULL;
+	float fps;
+	int collect_rval = EA_SUCCESS;
+	int batch_num = 0;
+	int slo_bound = 0;
+	int stream_idx;
+	int i, k;
+
+	do {
+		start_us = live_get_time_us();
+		while (batch_num < batch->batch_size) {
+			if (batch->pending_stream >= 0) {
+				stream_idx = batch->pending_stream;
+				batch->pending_stream = -1;
+			} else {
+				stream_idx = live_stream_schedule(live_ctx);
+			}
+			if (stream_idx < 0) {
+				break;
+			}
+			for (k = 0; k < batch_num; k++) {
+				if (slot_stream[k] == stream_idx) {
+					break;
+				}
+			}
+			if (k < batch_num && batch->one_per_stream) {
+				// one frame per stream in a batch, keep its turn for the next one
+				batch->pending_stream = stream_idx;
+				break;
+			}
+
+			// Holding a frame blocks, so only wait for one more while it can
+			// still arrive in time: the prefetched frame with a timeout, a
+			// direct hold when it usually takes less than what is left.
+			budget_us = UINT64_MAX;
+			if (batch_num > 0) {
+				budget_us = live_batch_budget(live_ctx, params, start_us,
+					hold_start_us, slot_stream, batch_num, &slo_bound);
+			}
+			slot = NULL;
+			hold_start_us[batch_num] = live_get_time_us();
+			if (live_ctx->prefetch.thread_created) {
+				// decoded ahead by the capture thread while the last batch ran
+				slot = budget_us == UINT64_MAX ? live_prefetch_acquire(live_ctx) :
+					live_prefetch_acquire_timed(live_ctx, budget_us);
+				wait_us = live_get_time_us() - hold_start_us[batch_num];
+			}
+			if ((live_ctx->prefetch.thread_created && slot == NULL) ||
+				(!live_ctx->prefetch.thread_created && batch->hold_us > budget_us)) {
+				batch->pending_stream = stream_idx;
+				if (slo_bound) {
+					batch->slo_flush_count++;
+				}
+				break;
+			}
+
+			// The frame is held and copied into its slice before the carrier
+			// is taken and seq advanced, so that an EOF or a failure leaves
+			// both untouched. Once taken, the frame is part of the batch.
+			stream = &live_ctx->stream[stream_idx];
+			ops = stream->input_ctx->ops;
+			if (slot != NULL) {
+				if (slot->rval == EA_SUCCESS && slot->eof == 0) {
+					commit_start_us = live_get_time_us();
+					rval = live_batch_fill_slice(live_ctx, slot->input, batch_num);
+					if (rval != EA_SUCCESS) {
+						for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+							ops->nn_input_release_data(&live_ctx->nn_input_ctx,
+								&(slot->img_set.img[i]), i);
+						}
+					}
+				} else {
+					rval = slot->rval;
+					stream->eof = slot->eof;
+				}
+				if (rval != EA_SUCCESS || stream->eof) {
+					// the frame does not join the batch, free the slot for
+					// the capture thread
+					live_prefetch_release(live_ctx, slot, wait_us, 0);
+				}
+			} else {
+				hold_start_us[batch_num] = live_get_time_us();
+				for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+					RVAL_OK(ops->nn_input_hold_data(stream->input_ctx, i,
+						batch->input[i], &data[i]));
+					if (data[i].tensor_group == NULL) {
+						stream->eof = 1;
+						break;
+					}
+				}
+				if (rval != EA_SUCCESS || stream->eof) {
+					// give back the frames already held on the earlier ports
+					for (k = 0; k < i; k++) {
+						ops->nn_input_release_data(stream->input_ctx, &data[k], k);
+					}
+				}
+				RVAL_BREAK();
+				wait_us = live_get_time_us() - hold_start_us[batch_num];
+				batch->hold_us = batch->hold_us == 0 ? wait_us :
+					(batch->hold_us * 7 + wait_us) / 8;
+				if (stream->eof == 0) {
+					RVAL_OK(live_batch_fill_slice(live_ctx, batch->input, batch_num));
+				}
+			}
+			RVAL_BREAK();
+			if (stream->eof) {
+				// nothing left to read, run what was collected
+				EA_LOG_NOTICE("All files are handled\n");
+				live_ctx->sig_flag = 1;
+				break;
+			}
+
+			vp_output[batch_num] = (vp_output_t *)ea_queue_request_carrier(
+				post_thread_queue(stream->thread_ctx));
+			RVAL_ASSERT(vp_output[batch_num] != NULL);
+			vp_output[batch_num]->out_num = live_ctx->nn_cvflow.out_num;
+			img_set[batch_num] = post_thread_get_img_set(stream->thread_ctx, stream->seq);
+			stream->seq++;
+			if (slot != NULL) {
+				for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+					img_set[batch_num]->img[i] = slot->img_set.img[i];
+				}
+				bgr = img_set[batch_num]->bgr;
+				img_set[batch_num]->bgr = slot->img_set.bgr;
+				slot->img_set.bgr = bgr;
+				live_prefetch_release(live_ctx, slot, wait_us,
+					live_get_time_us() - commit_start_us);
+			} else {
+				for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+					img_set[batch_num]->img[i] = data[i];
+				}
+			}
+			slot_stream[batch_num] = stream_idx;
+			batch_num++;
+			if (params->mode == RUN_LIVE_MODE &&
+				params->enable_hold_img_flag == IN_SRC_ON) {
+				RVAL_OK(YoloV8_Class::live_convert_yuv_data_to_bgr_data_for_postprocess(params,
+					img_set[batch_num - 1]));
+			}
+
+			// Run now if the window is over, or if waiting for one more frame
+			// would break the SLO of a frame already in the batch.
+			if (batch_num < batch->batch_size &&
+				live_batch_budget(live_ctx, params, start_us, hold_start_us,
+				slot_stream, batch_num, &slo_bound) == 0) {
+				if (slo_bound) {
+					batch->slo_flush_count++;
+				}
+				break;
+			}
+		}
+		// The frames collected before a failure still hold a carrier of
+		// their stream, run and queue them before stopping.
+		collect_rval = rval;
+		rval = EA_SUCCESS;
+		if (batch_num == 0) {
+			live_ctx->sig_flag = 1;
+			break;
+		}
+
+		// Slices past batch_num keep older frames, their results are dropped.
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			RVAL_OK(ea_tensor_sync_cache(nn_cvflow_input(&live_ctx->nn_cvflow, i),
+				EA_CPU, EA_VP));
+		}
+		RVAL_BREAK();
+		for (i = 0; i < vp_output[0]->out_num; i++) {
+			ea_net_update_output(live_ctx->nn_cvflow.net,
+				vp_output[0]->out[i].tensor_name, vp_output[0]->out[i].out);
+		}
+		forward_us = live_get_time_us();
+		EA_MEASURE_TIME_START();
+		RVAL_OK(nn_cvflow_inference(&live_ctx->nn_cvflow));
+		forward_us = live_get_time_us() - forward_us;
+		batch->forward_us = batch->forward_us == 0 ? forward_us :
+			(batch->forward_us * 7 + forward_us) / 8;
+		live_ctx->loop_count--;
+		if (live_ctx->loop_count == 0) {
+			EA_MEASURE_TIME_END("network forward time: ");
+			live_ctx->loop_count = INTERVAL_PRINT_PROCESS_TIME;
+		}
+		RVAL_OK(live_sync_net_output(live_ctx, vp_output[0]));
+
+		// The first carrier received the batched outputs, the other streams
+		// get their slice copied into the first slice of their own carrier.
+		// It is queued last, the postprocess may recycle it once queued.
+		for (k = batch_num - 1; k >= 0; k--) {
+			stream = &live_ctx->stream[slot_stream[k]];
+			if (k > 0) {
+				RVAL_OK(live_batch_split_output(live_ctx, vp_output[0], vp_output[k], k));
+			}
+			vp_output[k]->arg = img_set[k];
+			RVAL_OK(ea_queue_en(post_thread_queue(stream->thread_ctx), vp_output[k]));
+			latency_us = live_get_time_us() - hold_start_us[k];
+			slo_us = (uint64_t)(params->latency_slo_ms[slot_stream[k]] * 1000);
+			if (slo_us > 0 && latency_us > slo_us) {
+				stream->slo_miss++;
+			}
+			fps = ea_calc_fps(&stream->calc_fps_ctx);
+			if (fps > 0) {
+				EA_LOG_NOTICE("canvas %d fps %.1f\n", stream->canvas_id, fps);
+			}
+			live_stream_stat(live_ctx, stream, latency_us);
+		}
+		RVAL_BREAK();
+		live_ctx->cur_stream = slot_stream[batch_num - 1];
+
+		batch->batch_count++;
+		batch->frame_count += batch_num;
+		if (batch->batch_count == INTERVAL_PRINT_PROCESS_TIME) {
+			EA_LOG_NOTICE("batch: fill %.1f%% (%.2f of %d), forward %.2f ms, slo flush %d\n",
+				100.0f * batch->frame_count / (batch->batch_count * batch->batch_size),
+				(float)batch->frame_count / batch->batch_count, batch->batch_size,
+				batch->forward_us / 1000.0f, batch->slo_flush_count);
+			batch->batch_count = 0;
+			batch->frame_count = 0;
+			batch->slo_flush_count = 0;
+		}
+	} while (0);
+
+	if (rval != EA_SUCCESS || collect_rval != EA_SUCCESS) {
+		live_ctx->sig_flag = 1;
+	}
+
+	return live_ctx->sig_flag;
+};
+
+// Network input name of a port, from the "i:<name>=<source>" form of --isrc
+int YoloV8_Class::live_input_name(live_params_t *params, int port,
+	char *name, size_t len)
+{
+	const char *src = NULL;
+	const char *end = NULL;
+
+	if (port >= params->multi_in_num) {
+		return EA_FAIL;
+	}
+	src = params->multi_in_params[port];
+	if (strncmp(src, "i:", 2) != 0) {
+		return EA_FAIL;
+	}
+	src += 2;
+	end = strchr(src, '=');
+	if (end == NULL || end == src || (size_t)(end - src) >= len) {
+		return EA_FAIL;
+	}
+	memcpy(name, src, end - src);
+	name[end - src] = '\0';
+
+	return EA_SUCCESS;
+};
+
+int YoloV8_Class::live_prefetch_init(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	ea_tensor_t *input = NULL;
+	size_t shape[EA_DIM] = {0};
+	int i, j;
+
+	do {
+		RVAL_ASSERT(live_ctx->nn_cvflow.in_num <= NN_MAX_PORT_NUM);
+		prefetch->owner = this;
+		prefetch->params = params;
+		prefetch->slot_num = LIVE_PREFETCH_SLOT_NUM;
+		if (live_ctx->batch.enable) {
+			// keep a whole batch decoded ahead, one frame per slot
+			prefetch->slot_num = live_ctx->batch.batch_size * 2;
+			if (prefetch->slot_num > LIVE_PREFETCH_MAX_SLOT_NUM) {
+				prefetch->slot_num = LIVE_PREFETCH_MAX_SLOT_NUM;
+			}
+		}
+		for (j = 0; j < prefetch->slot_num; j++) {
+			for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+				input = nn_cvflow_input(&live_ctx->nn_cvflow, i);
+				memcpy(shape, ea_tensor_shape(input), sizeof(shape));
+				if (live_ctx->batch.enable) {
+					shape[EA_N] = 1;
+				}
+				prefetch->slot[j].input[i] = ea_tensor_new(ea_tensor_dtype(input),
+					shape, ea_tensor_pitch(input));
+				RVAL_ASSERT(prefetch->slot[j].input[i] != NULL);
+			}
+			RVAL_BREAK();
+		}
+		RVAL_BREAK();
+		// A batch is assembled from the slots slice by slice, only a single
+		// frame forward can take a slot tensor as it is.
+		prefetch->swap_input = !live_ctx->batch.enable;
+		for (i = 0; i < live_ctx->nn_cvflow.in_num && prefetch->swap_input; i++) {
+			prefetch->swap_input = live_input_name(params, i,
+				prefetch->input_name[i], sizeof(prefetch->input_name[i])) == EA_SUCCESS;
+			prefetch->net_input[i] = nn_cvflow_input(&live_ctx->nn_cvflow, i);
+			prefetch->cur_input[i] = prefetch->net_input[i];
+		}
+		if (!live_ctx->batch.enable && !prefetch->swap_input) {
+			EA_LOG_NOTICE("capture prefetch: input names unknown, frames are copied\n");
+		}
+		RVAL_ASSERT(pthread_mutex_init(&prefetch->lock, NULL) == 0);
+		RVAL_ASSERT(pthread_cond_init(&prefetch->cond, NULL) == 0);
+		RVAL_ASSERT(pthread_create(&prefetch->tidp, NULL,
+			live_prefetch_thread, live_ctx) == 0);
+		prefetch->thread_created = 1;
+		EA_LOG_NOTICE("capture prefetch enabled with %d slots\n", prefetch->slot_num);
+	} while (0);
+
+	return rval;
+}
+
+void YoloV8_Class::live_prefetch_deinit(live_ctx_t *live_ctx)
+{
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	int i, j;
+
+	if (prefetch->thread_created) {
+		pthread_mutex_lock(&prefetch->lock);
+		prefetch->exit_flag = 1;
+		pthread_cond_broadcast(&prefetch->cond);
+		pthread_mutex_unlock(&prefetch->lock);
+		pthread_join(prefetch->tidp, NULL);
+		pthread_cond_destroy(&prefetch->cond);
+		pthread_mutex_destroy(&prefetch->lock);
+		prefetch->thread_created = 0;
+	}
+	if (prefetch->swap_input) {
+		// give the network its own input back, the slot that holds it takes
+		// over the one in use instead
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			if (prefetch->cur_input[i] == prefetch->net_input[i]) {
+				continue;
+			}
+			ea_net_update_input(live_ctx->nn_cvflow.net, prefetch->input_name[i],
+				prefetch->net_input[i]);
+			for (j = 0; j < prefetch->slot_num; j++) {
+				if (prefetch->slot[j].input[i] == prefetch->net_input[i]) {
+					prefetch->slot[j].input[i] = prefetch->cur_input[i];
+				}
+			}
+			prefetch->cur_input[i] = prefetch->net_input[i];
+		}
+		prefetch->swap_input = 0;
+	}
+	for (j = 0; j < LIVE_PREFETCH_MAX_SLOT_NUM; j++) {
+		for (i = 0; i < NN_MAX_PORT_NUM; i++) {
+			if (prefetch->slot[j].input[i]) {
+				ea_tensor_free(prefetch->slot[j].input[i]);
+				prefetch->slot[j].input[i] = NULL;
+			}
+		}
+		if (prefetch->slot[j].img_set.bgr) {
+			ea_tensor_free(prefetch->slot[j].img_set.bgr);
+			prefetch->slot[j].img_set.bgr = NULL;
+		}
+	}
+}
+
+int YoloV8_Class::live_prefetch_capture(live_ctx_t *live_ctx,
+	live_params_t *params, live_prefetch_slot_t *slot)
+{
+	int rval = EA_SUCCESS;
+	nn_input_ops_type_t *ops = live_ctx->nn_input_ctx.ops;
+	uint64_t start_us = live_get_time_us();
+	int i, j;
+
+	do {
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			RVAL_OK(ops->nn_input_hold_data(&live_ctx->nn_input_ctx,
+				i, slot->input[i], &(slot->img_set.img[i])));
+			if (slot->img_set.img[i].tensor_group == NULL) {
+				slot->eof = 1;
+				break;
+			}
+		}
+		if (rval != EA_SUCCESS || slot->eof) {
+			// only complete frames are handed over, give back the earlier ports
+			for (j = 0; j < i; j++) {
+				ops->nn_input_release_data(&live_ctx->nn_input_ctx,
+					&(slot->img_set.img[j]), j);
+			}
+			break;
+		}
+		if (params->mode == RUN_LIVE_MODE &&
+			params->enable_hold_img_flag == IN_SRC_ON) {
+			RVAL_OK(live_convert_yuv_data_to_bgr_data_for_postprocess(params, &slot->img_set));
+		}
+	} while (0);
+	slot->capture_us = live_get_time_us() - start_us;
+
+	return rval;
+}
+
+void *YoloV8_Class::live_prefetch_thread(void *arg)
+{
+	live_ctx_t *live_ctx = (live_ctx_t *)arg;
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	YoloV8_Class *self = (YoloV8_Class *)prefetch->owner;
+	live_prefetch_slot_t *slot = NULL;
+	int stop = 0;
+
+	while (stop == 0) {
+		pthread_mutex_lock(&prefetch->lock);
+		while (prefetch->slot[prefetch->write_idx].filled &&
+			prefetch->exit_flag == 0) {
+			pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+		}
+		slot = &prefetch->slot[prefetch->write_idx];
+		stop = prefetch->exit_flag;
+		pthread_mutex_unlock(&prefetch->lock);
+		if (stop) {
+			break;
+		}
+
+		slot->rval = self->live_prefetch_capture(live_ctx, prefetch->params, slot);
+
+		pthread_mutex_lock(&prefetch->lock);
+		slot->filled = 1;
+		prefetch->write_idx = (prefetch->write_idx + 1) % prefetch->slot_num;
+		stop = (slot->eof || slot->rval != EA_SUCCESS);
+		pthread_cond_broadcast(&prefetch->cond);
+		pthread_mutex_unlock(&prefetch->lock);
+	}
+
+	return NULL;
+}
+
+live_prefetch_slot_t *YoloV8_Class::live_prefetch_acquire(live_ctx_t *live_ctx)
+{
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	live_prefetch_slot_t *slot = NULL;
+
+	pthread_mutex_lock(&prefetch->lock);
+	while (prefetch->slot[prefetch->read_idx].filled == 0) {
+		pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+	}
+	slot = &prefetch->slot[prefetch->read_idx];
+	pthread_mutex_unlock(&prefetch->lock);
+
+	return slot;
+}
+
+live_prefetch_slot_t *YoloV8_Class::live_prefetch_acquire_timed(live_ctx_t *live_ctx,
+	uint64_t timeout_us)
+{
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	live_prefetch_slot_t *slot = NULL;
+	struct timespec deadline;
+	uint64_t nsec;
+
+	// the condition variable waits on CLOCK_REALTIME
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	nsec = deadline.tv_nsec + timeout_us * 1000;
+	deadline.tv_sec += nsec / 1000000000;
+	deadline.tv_nsec = nsec % 1000000000;
+
+	pthread_mutex_lock(&prefetch->lock);
+	while (prefetch->slot[prefetch->read_idx].filled == 0) {
+		if (pthread_cond_timedwait(&prefetch->cond, &prefetch->lock,
+			&deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	if (prefetch->slot[prefetch->read_idx].filled) {
+		slot = &prefetch->slot[prefetch->read_idx];
+	}
+	pthread_mutex_unlock(&prefetch->lock);
+
+	return slot;
+}
+
+void YoloV8_Class::live_prefetch_release(live_ctx_t *live_ctx,
+	live_prefetch_slot_t *slot, uint64_t wait_us, uint64_t commit_us)
+{
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+
+	pthread_mutex_lock(&prefetch->lock);
+	prefetch->capture_us_sum += slot->capture_us;
+	prefetch->wait_us_sum += wait_us;
+	prefetch->commit_us_sum += commit_us;
+	prefetch->stat_count++;
+	slot->filled = 0;
+	prefetch->read_idx = (prefetch->read_idx + 1) % prefetch->slot_num;
+	pthread_cond_broadcast(&prefetch->cond);
+	pthread_mutex_unlock(&prefetch->lock);
+}
+
+int YoloV8_Class::live_prefetch_commit(live_ctx_t *live_ctx,
+	live_prefetch_slot_t *slot, img_set_t *img_set)
+{
+	int rval = EA_SUCCESS;
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	ea_tensor_t *input = NULL;
+	ea_tensor_t *bgr = NULL;
+	int i;
+
+	do {
+		for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+			if (prefetch->swap_input) {
+				// The network takes the staged tensor, the slot the previous
+				// input, which the last forward is done with.
+				input = prefetch->cur_input[i];
+				RVAL_OK(ea_net_update_input(live_ctx->nn_cvflow.net,
+					prefetch->input_name[i], slot->input[i]));
+				prefetch->cur_input[i] = slot->input[i];
+				slot->input[i] = input;
+			} else {
+				// The staging tensors were filled by the capture thread, so copy
+				// them into the network input before the slot is reused.
+				input = nn_cvflow_input(&live_ctx->nn_cvflow, i);
+				RVAL_ASSERT(ea_tensor_size(input) == ea_tensor_size(slot->input[i]));
+				RVAL_OK(ea_tensor_sync_cache(slot->input[i], EA_VP, EA_CPU));
+				memcpy(ea_tensor_data_for_write(input, EA_CPU),
+					ea_tensor_data_for_read(slot->input[i], EA_CPU), ea_tensor_size(input));
+				RVAL_OK(ea_tensor_sync_cache(input, EA_CPU, EA_VP));
+			}
+			img_set->img[i] = slot->img_set.img[i];
+		}
+		RVAL_BREAK();
+
+		// Swap the BGR tensors so that both the ring and the slot keep owning one.
+		bgr = img_set->bgr;
+		img_set->bgr = slot->img_set.bgr;
+		slot->img_set.bgr = bgr;
+	} while (0);
+
+	return rval;
+}
+
+int YoloV8_Class::live_run_loop_prefetch(live_ctx_t *live_ctx, live_params_t *params)
+{
+	int rval = EA_SUCCESS;
+	live_prefetch_ctx_t *prefetch = &live_ctx->prefetch;
+	live_prefetch_slot_t *slot = NULL;
+	ea_calc_fps_ctx_t calc_fps_ctx;
+	float fps;
+	ea_queue_t *queue = NULL;
+	vp_output_t *vp_output = NULL;
+	img_set_t *img_set;
+	uint64_t wait_start_us;
+	uint64_t wait_us;
+	uint64_t commit_start_us;
+	memset(&calc_fps_ctx, 0, sizeof(ea_calc_fps_ctx_t));
+	calc_fps_ctx.count_period = DEFAULT_FPS_COUNT_PERIOD;
+
+	do {
+		RVAL_OK(YoloV8_Class::live_update_net_output(live_ctx,
+			&live_ctx->thread_ctx, &vp_output));
+		img_set = post_thread_get_img_set(&live_ctx->thread_ctx, live_ctx->seq);
+		live_ctx->seq++;
+
+		wait_start_us = live_get_time_us();
+		slot = live_prefetch_acquire(live_ctx);
+		wait_us = live_get_time_us() - wait_start_us;
+
+		RVAL_OK(slot->rval);
+		if (slot->eof) {
+			EA_LOG_NOTICE("All files are handled\n");
+			live_ctx->sig_flag = 1;
+			break;
+		}
+		commit_start_us = live_get_time_us();
+		RVAL_OK(live_prefetch_commit(live_ctx, slot, img_set));
+		live_prefetch_release(live_ctx, slot, wait_us,
+			live_get_time_us() - commit_start_us);
+		RVAL_BREAK();
+
+		vp_output->arg = img_set;
+		EA_MEASURE_TIME_START();
+		RVAL_OK(nn_cvflow_inference(&live_ctx->nn_cvflow));
+		live_ctx->loop_count--;
+		if (live_ctx->loop_count == 0) {
+			EA_MEASURE_TIME_END("network forward time: ");
+			live_ctx->loop_count = INTERVAL_PRINT_PROCESS_TIME;
+		}
+		if (prefetch->stat_count == INTERVAL_PRINT_PROCESS_TIME) {
+			// Waiting on the capture thread and handing the staged frame to the
+			// network are left on the critical path, the rest of the hold time
+			// overlapped with inference.
+			EA_LOG_NOTICE("prefetch: hold %.2f ms, wait %.2f ms, commit %.2f ms, "
+				"saved %.2f ms per frame\n",
+				prefetch->capture_us_sum / 1000.0 / prefetch->stat_count,
+				prefetch->wait_us_sum / 1000.0 / prefetch->stat_count,
+				prefetch->commit_us_sum / 1000.0 / prefetch->stat_count,
+				((int64_t)prefetch->capture_us_sum - (int64_t)prefetch->wait_us_sum -
+				(int64_t)prefetch->commit_us_sum) / 1000.0 / prefetch->stat_count);
+			prefetch->capture_us_sum = 0;
+			prefetch->wait_us_sum = 0;
+			prefetch->commit_us_sum = 0;
+			prefetch->stat_count = 0;
+		}
+		if (params->mode == RUN_LIVE_MODE) {
+			fps = ea_calc_fps(&calc_fps_ctx);
+			if (fps > 0) {
+				EA_LOG_NOTICE("fps %.1f\n", fps);
+			}
+		}
+		RVAL_OK(live_sync_net_output(live_ctx, vp_output));
+		RVAL_OK(live_record_net_output(live_ctx, params, 0,
+			live_ctx->stream[0].track_frame, wait_start_us, vp_output));
 		queue = post_thread_queue(&live_ctx->thread_ctx);
 		RVAL_OK(ea_queue_en(queue, vp_output));
 	} while (0);
 
-	// return rval;
+	if (rval != EA_SUCCESS) {
+		live_ctx->sig_flag = 1;
+	}
+
+	return live_ctx->sig_flag;
+};
+
+int YoloV8_Class::live_run_loop_track(live_ctx_t *live_ctx, live_params_t *params,
+	live_stream_ctx_t *stream)
+{
+	int rval = EA_SUCCESS;
+	nn_input_ops_type_t *ops = stream->input_ctx->ops;
+	live_prefetch_slot_t *slot = NULL;
+	ea_img_resource_data_t data[NN_MAX_PORT_NUM];
+	uint64_t wait_start_us;
+	ea_tensor_t *bgr = NULL;
+	int hold_img = (params->enable_hold_img_flag == IN_SRC_ON);
+	int i;
+
+	do {
+		// No forward pass on this frame, but still consume one so that the
+		// predicted boxes advance at the capture pace. Its BGR is kept for
+		// Get_img so that the boxes are shown on the frame they predict.
+		if (live_ctx->prefetch.thread_created) {
+			wait_start_us = live_get_time_us();
+			slot = live_prefetch_acquire(live_ctx);
+			RVAL_OK(slot->rval);
+			if (slot->eof) {
+				live_ctx->sig_flag = 1;
+				break;
+			}
+			if (hold_img) {
+				bgr = stream->track_img_set.bgr;
+				stream->track_img_set.bgr = slot->img_set.bgr;
+				slot->img_set.bgr = bgr;
+			}
+			for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+				RVAL_OK(ops->nn_input_release_data(&live_ctx->nn_input_ctx,
+					&(slot->img_set.img[i]), i));
+			}
+			live_prefetch_release(live_ctx, slot, live_get_time_us() - wait_start_us, 0);
+			RVAL_BREAK();
+		} else {
+			for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+				RVAL_OK(ops->nn_input_hold_data(stream->input_ctx,
+					i, nn_cvflow_input(&live_ctx->nn_cvflow, i), &data[i]));
+				if (data[i].tensor_group == NULL) {
+					live_ctx->sig_flag = 1;
+					break;
+				}
+			}
+			RVAL_BREAK();
+			if (live_ctx->sig_flag) {
+				break;
+			}
+			if (hold_img) {
+				stream->track_img_set.img[0] = data[0];
+				RVAL_OK(live_convert_yuv_data_to_bgr_data_for_postprocess(params,
+					&stream->track_img_set));
+			}
+			for (i = 0; i < live_ctx->nn_cvflow.in_num; i++) {
+				RVAL_OK(ops->nn_input_release_data(stream->input_ctx,
+					&data[i], i));
+			}
+		}
+	} while (0);
+
+	if (rval != EA_SUCCESS) {
+		live_ctx->sig_flag = 1;
+	}
+
 	return live_ctx->sig_flag;
 };
 
+int YoloV8_Class::live_track_interval(live_params_t *params,
+	BoxTracker *stream_tracker)
+{
+	int interval = params->track_interval;
+
+	if (stream_tracker->getMotion() > TRACK_MOTION_HIGH) {
+		interval = 1;
+	} else if (stream_tracker->getMotion() > TRACK_MOTION_MID) {
+		interval = (interval + 1) / 2;
+	}
+	if (stream_tracker->getTrackNum() > TRACK_CROWD_NUM) {
+		interval = (interval + 1) / 2;
+	}
+
+	return interval < 1 ? 1 : interval;
+}
+
+void YoloV8_Class::live_track_update(live_ctx_t *live_ctx, live_params_t *params,
+	int stream_idx, std::vector<BoundingBox> &bboxList)
+{
+	live_stream_ctx_t *stream = &live_ctx->stream[stream_idx];
+	ea_tensor_t *input = nn_cvflow_input(&live_ctx->nn_cvflow, 0);
+	int track_w = ea_tensor_shape(input)[EA_W];
+	int track_h = ea_tensor_shape(input)[EA_H];
+	std::vector<BoundingBox> trackList;
+	size_t i;
+
+	if (tracker[stream_idx] == NULL) {
+		tracker[stream_idx] = new BoxTracker(track_w, track_h);
+	}
+
+	if (stream->frame_predicted) {
+		tracker[stream_idx]->predict(trackList, stream->track_frame);
+		for (i = 0; i < trackList.size(); i++) {
+			trackList[i].x1 /= track_w;
+			trackList[i].y1 /= track_h;
+			trackList[i].x2 /= track_w;
+			trackList[i].y2 /= track_h;
+			bboxList.push_back(trackList[i]);
+		}
+		return;
+	}
+
+	// Results are normalized, track in input pixels so that the tracker's
+	// integer center points stay meaningful.
+	for (i = 0; i < bboxList.size(); i++) {
+		trackList.push_back(BoundingBox(bboxList[i].x1 * track_w,
+			bboxList[i].y1 * track_h, bboxList[i].x2 * track_w,
+			bboxList[i].y2 * track_h, bboxList[i].label));
+		trackList.back().confidence = bboxList[i].confidence;
+	}
+	tracker[stream_idx]->update(trackList, stream->track_frame);
+	stream->track_skip_left = live_track_interval(params, tracker[stream_idx]) - 1;
+}
+
 int YoloV8_Class::live_run_loop(live_ctx_t *live_ctx, live_params_t *params)
 {
 	int rval = EA_SUCCESS;
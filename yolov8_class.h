@@ -4,6 +4,10 @@
  ******************************************************************************/
 #include "yolov8_struct.h"
 #include "yolov8_utils/object.hpp"
+#include "yolov8_utils/box_tracker.hpp"
+#include "yolov8_utils/frame_dataset.hpp"
+#include "yolov8_utils/tensor_record.hpp"
+#include "yolov8_utils/img_convert.hpp"
 #include "opencv2/core.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp"
@@ -16,6 +20,28 @@ class YoloV8_Class
         // live_ctx_t *live_ctx;
         live_params_t *params;
         live_ctx_t *live_ctx;
+
+        // detect-then-track, one tracker per stream
+        BoxTracker *tracker[LIVE_MAX_STREAM_NUM];
+
+        // raw frame dump of Get_img, see --frame_dump
+        FrameDatasetWriter *frame_writer;
+
+        // network output recording, see --record_output
+        TensorRecordWriter *tensor_recorder;
+
+        // replay of a recording, see --replay_output. The frame read last
+        // is kept while the frames before it are predicted.
+        TensorRecordReader *tensor_replayer;
+        RecordedFrame replay_frame;
+        int replay_pending;
+
+        // frame buffers returned by Get_img, also for the black frame
+        // returned before the first result
+        imgConvert::MatPool frame_pool;
+
+        // NV12 conversion tables, kept between frames
+        imgConvert::Nv12Converter nv12_converter;
         // static void sig_stop(int a)
         // {
         //         (void)a;
@@ -63,8 +89,17 @@ class YoloV8_Class
         void yolov8_thread_join();
 
 
+        // Frame of the last Get_Yolov8_Bounding_Boxes result: the inferred
+        // frame, or on a tracked frame the frame the boxes were predicted for
         cv::Mat Get_img();
 
+        cv::Mat Get_img(int stream);
+
+        int Get_Current_Stream();
+
+        int Get_img_planes(int stream,
+                        std::vector<cv::Mat> &planes);
+
         Object test_yolov8_tracker(live_ctx_t *live_ctx, 
                         live_params_t *params);
 
@@ -74,6 +109,9 @@ class YoloV8_Class
 
         int Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList);
 
+        int Get_Yolov8_Bounding_Boxes(std::vector<BoundingBox> &bboxList,
+                                        int stream);
+
 
         void Draw_Yolov8_Bounding_Boxes(std::vector<BoundingBox> bboxList,live_ctx_t *live_ctx, live_params_t *params);
 
@@ -120,10 +158,77 @@ class YoloV8_Class
         
         void cv_env_deinit(live_ctx_t *live_ctx);
 
+        int live_input_init(nn_input_context_type_t *ctx,
+                        live_params_t *params,
+                        int canvas_id);
+
+        int live_stream_init(live_ctx_t *live_ctx,
+                        live_params_t *params);
+
+        void live_stream_deinit(live_ctx_t *live_ctx);
+
+        int live_stream_schedule(live_ctx_t *live_ctx);
+
+        ea_tensor_t *live_frame_bgr(int stream);
+
+        void live_stream_stat(live_ctx_t *live_ctx,
+                        live_stream_ctx_t *stream,
+                        uint64_t latency_us);
+
+        int live_batch_init(live_ctx_t *live_ctx,
+                        live_params_t *params);
+
+        void live_batch_deinit(live_ctx_t *live_ctx);
+
+        int live_batch_fill_slice(live_ctx_t *live_ctx,
+                        ea_tensor_t **src,
+                        int slice_idx);
+
+        int live_batch_split_output(live_ctx_t *live_ctx,
+                        vp_output_t *src,
+                        vp_output_t *dst,
+                        int slice_idx);
+
+        uint64_t live_batch_budget(live_ctx_t *live_ctx,
+                        live_params_t *params,
+                        uint64_t start_us,
+                        const uint64_t *hold_start_us,
+                        const int *slot_stream,
+                        int batch_num,
+                        int *slo_bound);
+
+        int live_run_loop_batch(live_ctx_t *live_ctx,
+                        live_params_t *params);
+
 
         int live_update_net_output(live_ctx_t *live_ctx,
+                                post_thread_ctx_t *thread_ctx,
 	                            vp_output_t **vp_output);
+
+        int live_declare_output_usage(live_ctx_t *live_ctx,
+                                    live_params_t *params);
+
+        int live_output_synced(live_ctx_t *live_ctx,
+                                const char *tensor_name);
+
+        int live_sync_net_output(live_ctx_t *live_ctx,
+                                vp_output_t *vp_output);
+
+        static int live_output_index(vp_output_t *vp_output,
+                                const char *tensor_name);
         
+        int live_record_net_output(live_ctx_t *live_ctx,
+                                live_params_t *params,
+                                int stream_idx,
+                                uint64_t seq,
+                                uint64_t timestamp_us,
+                                vp_output_t *vp_output);
+
+        void live_record_deinit();
+
+        int live_run_loop_replay(live_ctx_t *live_ctx,
+                                live_params_t *params);
+
         int live_run_loop_dummy(live_ctx_t *live_ctx, 
                                 live_params_t *params);
 
@@ -133,5 +238,48 @@ class YoloV8_Class
         int live_run_loop_without_dummy(live_ctx_t *live_ctx, 
                                         live_params_t *params);
 
+        int live_prefetch_init(live_ctx_t *live_ctx, 
+                                live_params_t *params);
+
+        void live_prefetch_deinit(live_ctx_t *live_ctx);
+
+        int live_input_name(live_params_t *params, int port,
+                                char *name, size_t len);
+
+        int live_prefetch_capture(live_ctx_t *live_ctx, 
+                                live_params_t *params,
+                                live_prefetch_slot_t *slot);
+
+        int live_prefetch_commit(live_ctx_t *live_ctx, 
+                                live_prefetch_slot_t *slot,
+                                img_set_t *img_set);
+
+        int live_run_loop_prefetch(live_ctx_t *live_ctx, 
+                                live_params_t *params);
+
+        static void *live_prefetch_thread(void *arg);
+
+        live_prefetch_slot_t *live_prefetch_acquire(live_ctx_t *live_ctx);
+
+        live_prefetch_slot_t *live_prefetch_acquire_timed(live_ctx_t *live_ctx,
+                                uint64_t timeout_us);
+
+        void live_prefetch_release(live_ctx_t *live_ctx,
+                                live_prefetch_slot_t *slot,
+                                uint64_t wait_us,
+                                uint64_t commit_us);
+
+        int live_run_loop_track(live_ctx_t *live_ctx, 
+                                live_params_t *params,
+                                live_stream_ctx_t *stream);
+
+        void live_track_update(live_ctx_t *live_ctx, 
+                                live_params_t *params,
+                                int stream_idx,
+                                std::vector<BoundingBox> &bboxList);
+
+        int live_track_interval(live_params_t *params,
+                                BoxTracker *stream_tracker);
+
         
 };
\ No newline at end of file
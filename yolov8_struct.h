@@ -15,6 +15,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
 
 #include <eazyai.h>
 #include <nn_arm.h>
@@ -29,8 +32,18 @@ extern "C" {
 
 #define INTERVAL_PRINT_PROCESS_TIME 30
 #define TO_FILE_POSTPROCESS_NAME "to_file"
+#define YOLOV8_POSTPROCESS_NAME "yolov8"
 #define DEFAULT_FPS_COUNT_PERIOD 100
 
+// Detect-then-track: shrink the inference interval when objects move fast
+// (center displacement per frame relative to box height) or the scene is crowded.
+#define TRACK_MOTION_HIGH 0.08f
+#define TRACK_MOTION_MID 0.03f
+#define TRACK_CROWD_NUM 16
+
+#define LIVE_MAX_STREAM_NUM 4
+#define LIVE_MAX_BATCH_NUM 16
+
 #define CANVAS
 #ifdef CANVAS
 #define DEFAULT_CANVAS_ID 1
@@ -127,6 +140,11 @@ typedef struct live_params_s {
 	int yuv_flag;
 	int use_pyramid;
 	int feature;
+	int enable_prefetch_flag;
+	int file_batch_flag;
+	int stream_num;
+	int stream_canvas[LIVE_MAX_STREAM_NUM];
+	int stream_weight[LIVE_MAX_STREAM_NUM];
 
 	//Preprocess parameters, include color conversion, roi.
 	int rgb;
@@ -136,6 +154,9 @@ typedef struct live_params_s {
 	const char *model_path;
 	const char *ades_cmd_file;
 	int acinf_gpu_id;
+	int track_interval;
+	float batch_window_ms;
+	float latency_slo_ms[LIVE_MAX_STREAM_NUM];
 
 	//Model postprocessing parameters, include name, lua file path, etc.
 	const char *arm_nn_name;
@@ -155,13 +176,108 @@ typedef struct live_params_s {
 	int vout_id;
 	int draw_mode;
 	char output_dir[MAX_STR_LEN + 1];
+	const char *frame_dump_path;
+	const char *record_output_path;
+	int record_compress_flag;
+	const char *replay_output_path;
 
 	//Miscellaneous
 	int support;
+	int convert_bench;
 	int log_level;
 
 } live_params_t;
 
+#define LIVE_PREFETCH_SLOT_NUM 2
+#define LIVE_PREFETCH_MAX_SLOT_NUM 16
+
+typedef struct live_prefetch_slot_s {
+	img_set_t img_set;
+	ea_tensor_t *input[NN_MAX_PORT_NUM];
+	int filled;
+	int eof;
+	int rval;
+	uint64_t capture_us;
+} live_prefetch_slot_t;
+
+typedef struct live_prefetch_ctx_s {
+	pthread_t tidp;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	live_prefetch_slot_t slot[LIVE_PREFETCH_MAX_SLOT_NUM];
+	int slot_num;
+	int write_idx;
+	int read_idx;
+	int thread_created;
+	int exit_flag;
+	void *owner;
+	live_params_t *params;
+
+	// The held frame is handed to the network by swapping the slot tensor
+	// with the network input (ea_net_update_input), so nothing is copied.
+	// net_input is the tensor the network owns, put back at deinit.
+	int swap_input;
+	char input_name[NN_MAX_PORT_NUM][MAX_STR_LEN + 1];
+	ea_tensor_t *net_input[NN_MAX_PORT_NUM];
+	ea_tensor_t *cur_input[NN_MAX_PORT_NUM];
+
+	// statistics of how much capture time is hidden behind inference
+	uint64_t capture_us_sum;
+	uint64_t wait_us_sum;
+	uint64_t commit_us_sum;
+	int stat_count;
+} live_prefetch_ctx_t;
+
+// One input served by the shared network. Stream 0 points at the
+// nn_input_ctx/thread_ctx of live_ctx_t, the others own their storage.
+typedef struct live_stream_ctx_s {
+	nn_input_context_type_t *input_ctx;
+	post_thread_ctx_t *thread_ctx;
+	nn_input_context_type_t input_storage;
+	post_thread_ctx_t thread_storage;
+	int input_inited;
+	int thread_inited;
+	unsigned int seq;
+	int canvas_id;
+	int eof;
+
+	// smooth weighted round-robin
+	int weight;
+	int current_weight;
+
+	// detect-then-track state
+	int track_frame;
+	int track_skip_left;
+	int frame_predicted;
+	img_set_t track_img_set;	// BGR of the last predicted frame
+
+	// statistics
+	ea_calc_fps_ctx_t calc_fps_ctx;
+	uint64_t latency_us_sum;
+	uint64_t latency_us_max;
+	int slo_miss;
+	int stat_count;
+} live_stream_ctx_t;
+
+// Cross-stream micro-batching: frames of different streams are packed into
+// the batch slices of the network input and run in one forward.
+typedef struct live_batch_ctx_s {
+	int enable;
+	int batch_size;
+	int pending_stream;
+	int one_per_stream;
+	uint64_t window_us;
+	ea_tensor_t *input[NN_MAX_PORT_NUM];
+	size_t input_slice[NN_MAX_PORT_NUM];
+	uint64_t forward_us;
+	uint64_t hold_us;
+
+	// statistics
+	int batch_count;
+	int frame_count;
+	int slo_flush_count;
+} live_batch_ctx_t;
+
 typedef struct live_ctx_s {
 	nn_cvflow_t nn_cvflow;
 	post_thread_ctx_t thread_ctx;
@@ -171,6 +287,16 @@ typedef struct live_ctx_s {
 	nn_input_context_type_t nn_input_ctx;
 	int loop_count;
 	int f_result;
+	live_prefetch_ctx_t prefetch;
+
+	// outputs read by the arm postprocess, only these are synced to CPU
+	yolov8_arm_cfg_t arm_cfg;
+	int sync_all_outputs;
+
+	live_stream_ctx_t stream[LIVE_MAX_STREAM_NUM];
+	int stream_num;
+	int cur_stream;
+	live_batch_ctx_t batch;
 } live_ctx_t;
 
 EA_LOG_DECLARE_LOCAL(EA_LOG_LEVEL_NOTICE);
@@ -205,6 +331,18 @@ typedef enum live_numeric_short_options_e {
 	OPTION_FSYNC_OFF,
 	OPTION_RESULT_TO_TXT,
 	OPTION_HOLD_IMG,
+	OPTION_PREFETCH,
+	OPTION_TRACK_INTERVAL,
+	OPTION_MULTI_CANVAS,
+	OPTION_STREAM_WEIGHT,
+	OPTION_BATCH_WINDOW,
+	OPTION_LATENCY_SLO,
+	OPTION_FILE_BATCH,
+	OPTION_FRAME_DUMP,
+	OPTION_RECORD_OUTPUT,
+	OPTION_RECORD_LZ4,
+	OPTION_REPLAY_OUTPUT,
+	OPTION_CONVERT_BENCH,
 } live_numeric_short_options_t;
 
 #define INPUT_OPTIONS \
@@ -212,7 +350,12 @@ typedef enum live_numeric_short_options_e {
 	{"pyramid_id", HAS_ARG, 0, 'p'}, \
 	{"mode", HAS_ARG, 0, 'm'}, \
 	{"isrc", HAS_ARG, 0, OPTION_MULTI_IN}, \
-	{"yuv", NO_ARG, 0, OPTION_YUV}
+	{"yuv", NO_ARG, 0, OPTION_YUV}, \
+	{"prefetch", NO_ARG, 0, OPTION_PREFETCH}, \
+	{"multi_canvas", HAS_ARG, 0, OPTION_MULTI_CANVAS}, \
+	{"stream_weight", HAS_ARG, 0, OPTION_STREAM_WEIGHT}, \
+	{"file_batch", NO_ARG, 0, OPTION_FILE_BATCH}, \
+	{"replay_output", HAS_ARG, 0, OPTION_REPLAY_OUTPUT}
 
 #define PREPROCESS_OPTIONS \
 	{"rgb", NO_ARG, 0, 'r'}, \
@@ -221,7 +364,10 @@ typedef enum live_numeric_short_options_e {
 #define INFERENCE_OPTIONS \
 	{"model_path", HAS_ARG, 0, OPTION_MODEL_PATH}, \
 	{"ades_cmd_file", HAS_ARG, 0, OPTION_ADES_CMD_FILE}, \
-	{"acinf_gpu_id", HAS_ARG, 0, OPTION_ACINF_GPU_ID}
+	{"acinf_gpu_id", HAS_ARG, 0, OPTION_ACINF_GPU_ID}, \
+	{"track_interval", HAS_ARG, 0, OPTION_TRACK_INTERVAL}, \
+	{"batch_window", HAS_ARG, 0, OPTION_BATCH_WINDOW}, \
+	{"latency_slo", HAS_ARG, 0, OPTION_LATENCY_SLO}
 
 #define POSTPROCESS_OPTIONS \
 	{"nn_arm_name", HAS_ARG, 0, 'n'}, \
@@ -240,10 +386,14 @@ typedef enum live_numeric_short_options_e {
 	{"to_txt", HAS_ARG, 0, OPTION_RESULT_TO_TXT}, \
 	{"vout_id", HAS_ARG, 0, OPTION_VOUT_ID}, \
 	{"draw_mode", HAS_ARG, 0, 'd'}, \
-	{"output_dir", HAS_ARG, 0, OPTION_OUTPUT_DIR}
+	{"output_dir", HAS_ARG, 0, OPTION_OUTPUT_DIR}, \
+	{"frame_dump", HAS_ARG, 0, OPTION_FRAME_DUMP}, \
+	{"record_output", HAS_ARG, 0, OPTION_RECORD_OUTPUT}, \
+	{"record_lz4", NO_ARG, 0, OPTION_RECORD_LZ4}
 
 #define MISCELLANEOUS_OPTIONS \
 	{"support", NO_ARG, 0, OPTION_SUPPORT_LIST}, \
+	{"convert_bench", NO_ARG, 0, OPTION_CONVERT_BENCH}, \
 	{"log_level", HAS_ARG, 0, 'v'}, \
 	{0, 0, 0, 0}
 
@@ -269,11 +419,19 @@ static const struct hint_s hint[] = {
 	{"", "\t\trun mode"},
 	{"", "\t\tmulti input, e.g. -isrc \"i:data=image|t:jpeg|c:rgb|r:0,0,0,0|d:cpu\". Only for file mode."},
 	{"", "\t\tenable yuv input from iav, default is disable."},
+	{"", "\t\thold the next frame on a capture thread while the current frame is in inference, default is disable."},
+	{"", "\t\tcanvas ids served by one network, e.g. --multi_canvas 1,2,3. At most 4. Only for live mode."},
+	{"", "\t\tscheduling weight of each canvas in --multi_canvas, e.g. --stream_weight 2,1,1. Default is 1 for each."},
+	{"", "\t\tpack consecutive images into the network batch and run them in one forward. Only for file mode."},
+	{"", "\trun the postprocess and tracking on the outputs of a --record_output file instead of the network, no frame is read."},
 	{"", "\t\tset color type to rgb_planar, default is bgr_planar. Only for live mode."},
 	{"", "\t\troi of image, default is full image, order of roi parameters: x,y,h,w. Only for live mode."},
 	{"", "\t\tpath of cavalry bin file."},
 	{"", "\t\ades command file path. Run Ades if specified, otherwise run ACINF."},
 	{"", "\tacinf gpu id, default is -1(CPU). Only for Acinference."},
+	{"", "\tmax frames between inferences, boxes in between are predicted by tracking, default is 1. Only for live mode."},
+	{"", "\t\tms to wait for frames of other canvases to fill the network batch, default is 0(disable). Only for multi canvas."},
+	{"", "\t\tper canvas latency limit in ms, a batch is run early to meet it, e.g. --latency_slo 33,33,66. Default is 0(no limit)."},
 	{"", "\tnn arm task name."},
 	{"", "\t\tqueue size, default is 1."},
 	{"", "\t\tlua file name."},
@@ -289,7 +447,11 @@ static const struct hint_s hint[] = {
 	{"", "\t\tvout id for display, default is 1, means to use HDMI/CVBS."},
 	{"", "\t\tdraw mode, 0=draw bbox, 1=draw img."},
 	{"", "\t\tpath to contain output file."},
+	{"", "\t\tsave the frames returned by Get_img to a raw frame dataset for replay."},
+	{"", "\trecord the network outputs of every frame to a file for replay of the postprocess."},
+	{"", "\t\tcompress the chunks of --record_output, default is disable."},
 	{"", "\t\tshow support list."},
+	{"", "\ttime the planar to interleaved conversion against cv::merge at 1080p and 4K, then exit."},
 	{"", "\t\tlog level 0=None, 1=Error, 2=Notice, 3=Debug, 4=Verbose."},
 };
 
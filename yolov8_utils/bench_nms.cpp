@@ -0,0 +1,129 @@
+// NMS methods on 50, 500 and 5000 candidates, with one IoU threshold and
+// with per class thresholds and quotas: time per call and a check that
+// both keep the same boxes. Built with -DBUILD_BENCH=ON (tests/CMakeLists.txt),
+// or by hand:
+//
+//   g++ -O3 -std=gnu++11 -I. -I<dir of yolo_adas_decoder.hpp> bench_nms.cpp
+//     box_nms.cpp -o bench_nms
+//
+// Candidates are clusters of jittered boxes around objects spread over a
+// 640x384 input, the way a crowded scene at a low threshold looks.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "box_nms.hpp"
+
+using namespace std;
+
+
+static vector<struct v8xyxy> _makeCandidates(int count, int perObject)
+{
+  vector<struct v8xyxy> boxes;
+  while ((int)boxes.size() < count)
+  {
+    int w = 12 + rand() % 120;
+    int h = 12 + rand() % 120;
+    int x = rand() % (640 - w);
+    int y = rand() % (384 - h);
+    int c = rand() % 6;
+
+    for (int i = 0; i < perObject && (int)boxes.size() < count; i++)
+    {
+      struct v8xyxy b;
+      b.x1 = x + rand() % 7 - 3;
+      b.y1 = y + rand() % 7 - 3;
+      b.x2 = x + w + rand() % 7 - 3;
+      b.y2 = y + h + rand() % 7 - 3;
+      b.c = c;
+      b.c_prob = 0.25f + (rand() % 7500) / 10000.0f;
+      boxes.push_back(b);
+    }
+  }
+
+  return boxes;
+}
+
+
+static bool _sameBoxes(const vector<struct v8xyxy> &a, int numA, const vector<struct v8xyxy> &b, int numB)
+{
+  if (numA != numB)
+    return false;
+
+  for (int i = 0; i < numA; i++)
+  {
+    if (a[i].x1 != b[i].x1 || a[i].y1 != b[i].y1 || a[i].x2 != b[i].x2 || a[i].y2 != b[i].y2 ||
+        a[i].c != b[i].c || a[i].c_prob != b[i].c_prob)
+      return false;
+  }
+
+  return true;
+}
+
+
+static double _bench(const std::function<void()> &op, int iterations)
+{
+  auto t0 = std::chrono::high_resolution_clock::now();
+  for (int it = 0; it < iterations; it++)
+  {
+    op();
+  }
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (1e6 * iterations);
+}
+
+
+int main()
+{
+  const int maxOut = 5000;
+  const int counts[] = {50, 500, 5000};
+
+  // Uniform, and per class: strict on signs, capped vehicles and signs
+  NmsParams uniform = NmsParams::uniform(0.5f);
+  NmsParams perClass = uniform;
+  perClass.classes.resize(6);
+  perClass.classes[1].topK = 40;
+  perClass.classes[2].iouThreshold = 0.6f;
+  perClass.classes[3].confThreshold = 0.6f;
+  perClass.classes[4].confThreshold = 0.7f;
+  perClass.classes[4].iouThreshold = 0.3f;
+  perClass.classes[4].topK = 10;
+  const NmsParams *paramList[] = {&uniform, &perClass};
+  const char *paramNames[] = {"uniform", "per class"};
+
+  srand(1);
+  GridNms gridNms;
+  vector<struct v8xyxy> outPairwise(maxOut), outGrid(maxOut);
+
+  printf("params     candidates  pairwise      grid          kept  same\n");
+  for (int p = 0; p < 2; p++)
+  {
+    for (int count : counts)
+    {
+      vector<struct v8xyxy> candidates = _makeCandidates(count, 10);
+      vector<struct v8xyxy> work;
+      int numPairwise = 0, numGrid = 0;
+      int iterations = count >= 5000 ? 20 : 2000;
+
+      double msPairwise = _bench([&]() {
+        work = candidates;
+        numPairwise = boxNms::pairwise(work, *paramList[p], &outPairwise[0], maxOut);
+      }, iterations);
+
+      double msGrid = _bench([&]() {
+        work = candidates;
+        numGrid = gridNms.run(work, *paramList[p], &outGrid[0], maxOut);
+      }, iterations);
+
+      bool same = _sameBoxes(outPairwise, numPairwise, outGrid, numGrid);
+      printf("%-10s %-10d  %-10.4f ms %-10.4f ms %-5d %s\n",
+        paramNames[p], count, msPairwise, msGrid, numGrid, same ? "yes" : "NO");
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,173 @@
+// Detection output storage, float32 vs fp16: time per frame and accuracy.
+// Needs no SNPE. Built with -DBUILD_BENCH=ON (tests/CMakeLists.txt), or by hand:
+//
+//   g++ -O3 -std=gnu++11 -mf16c -I. bench_output_fp16.cpp half_float.cpp
+//     quantized_output.cpp -o bench_output_fp16          (x86, F16C)
+//   aarch64-linux-gnu-g++ with the same arguments, no -mf16c (NEON)
+//
+// Synthetic outputs of a 384x640 model: det_box [anchors, 5], det_conf and
+// det_cls [anchors], about 1 % of the anchors above the threshold. Each
+// case runs with warm caches and with the outputs evicted first, as after
+// the accelerator wrote them. The survivors are checked against float32,
+// the exit status is 1 when a class id doesn't come back exactly.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "half_float.hpp"
+#include "quantized_output.hpp"
+
+using namespace std;
+
+
+static vector<char> s_evictBuff(32 << 20);
+
+
+// Average ms per call, optionally with the caches flushed before each call
+static double _bench(const std::function<void()> &op, int iterations, bool cold)
+{
+  double totalNs = 0;
+  for (int it = 0; it < iterations; it++)
+  {
+    if (cold)
+    {
+      for (size_t i = 0; i < s_evictBuff.size(); i += 64)
+      {
+        s_evictBuff[i]++;
+      }
+    }
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    op();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+  }
+
+  return totalNs / (1e6 * iterations);
+}
+
+
+int main(int argc, char **argv)
+{
+  const int numAnchors = 3780;
+  const int boxDim = 5;
+  const float confThreshold = 0.5f;
+  int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+
+  // Outputs as the runtime writes them
+  srand(1);
+  vector<float> box(numAnchors * boxDim), conf(numAnchors), cls(numAnchors);
+  for (int a = 0; a < numAnchors; a++)
+  {
+    for (int k = 0; k < boxDim; k++)
+    {
+      box[a * boxDim + k] = (rand() % 64000) / 100.0f;
+    }
+    conf[a] = (rand() % 100 == 0) ? 0.5f + (rand() % 5000) / 10000.0f : (rand() % 5000) / 10000.0f;
+    cls[a] = (float)(rand() % 6);
+  }
+
+  vector<uint16_t> boxH(box.size()), confH(conf.size()), clsH(cls.size());
+  halfKernel::fromFloat(&box[0], &boxH[0], box.size());
+  halfKernel::fromFloat(&conf[0], &confH[0], conf.size());
+  halfKernel::fromFloat(&cls[0], &clsH[0], cls.size());
+
+  vector<float> boxOut(box.size()), confOut(conf.size()), clsOut(cls.size());
+
+  // float32: output tensors copied to the decoder buffers, then scanned
+  int passedFloat = 0;
+  auto opFloat = [&]() {
+    memcpy(&boxOut[0], &box[0], box.size() * sizeof(float));
+    memcpy(&confOut[0], &conf[0], conf.size() * sizeof(float));
+    memcpy(&clsOut[0], &cls[0], cls.size() * sizeof(float));
+    int n = 0;
+    for (int a = 0; a < numAnchors; a++)
+    {
+      n += confOut[a] >= confThreshold;
+    }
+    passedFloat = n;
+  };
+
+  // fp16: thresholded in fp16, survivors converted
+  QuantizedDetectionFilter filter;
+  filter.setParams(QuantParams(), QuantParams(), QuantParams(), numAnchors, boxDim, true);
+  int passedHalf = 0;
+  auto opHalf = [&]() {
+    passedHalf = filter.runHalf(&boxH[0], &confH[0], &clsH[0], confThreshold, &boxOut[0], &confOut[0], &clsOut[0]);
+  };
+
+  // fp16: whole tensors converted back to float
+  auto opHalfFull = [&]() {
+    halfKernel::toFloat(&boxH[0], &boxOut[0], boxH.size());
+    halfKernel::toFloat(&confH[0], &confOut[0], confH.size());
+    halfKernel::toFloat(&clsH[0], &clsOut[0], clsH.size());
+  };
+
+  double msFloat[2], msHalf[2], msHalfFull[2];
+  for (int cold = 0; cold < 2; cold++)
+  {
+    int n = cold ? iterations / 50 + 1 : iterations;
+    msFloat[cold] = _bench(opFloat, n, cold != 0);
+    msHalf[cold] = _bench(opHalf, n, cold != 0);
+    msHalfFull[cold] = _bench(opHalfFull, n, cold != 0);
+  }
+
+  // Accuracy of the survivors against float32
+  filter.runHalf(&boxH[0], &confH[0], &clsH[0], confThreshold, &boxOut[0], &confOut[0], &clsOut[0]);
+  double maxBoxErr = 0, maxConfErr = 0;
+  int flipped = 0, clsErr = 0;
+  for (int a = 0; a < numAnchors; a++)
+  {
+    bool passF = conf[a] >= confThreshold;
+    bool passH = confOut[a] >= confThreshold;
+    flipped += passF != passH;
+    if (!(passF && passH))
+      continue;
+
+    maxConfErr = std::max(maxConfErr, (double)fabs(confOut[a] - conf[a]));
+    clsErr += clsOut[a] != cls[a];
+    for (int k = 0; k < boxDim; k++)
+    {
+      maxBoxErr = std::max(maxBoxErr, (double)fabs(boxOut[a * boxDim + k] - box[a * boxDim + k]));
+    }
+  }
+
+  // 8-bit outputs, with a class quantization whose grid misses the integers
+  QuantParams clsQ;
+  clsQ.step = 6.0f / 255.0f;
+  vector<uint8_t> confQ(numAnchors), clsQv(numAnchors), boxQ(box.size(), 0);
+  for (int a = 0; a < numAnchors; a++)
+  {
+    confQ[a] = (uint8_t)std::min(255.0f, std::round(conf[a] * 255.0f));
+    clsQv[a] = (uint8_t)std::round(cls[a] / clsQ.step);
+  }
+  QuantParams confQParams;
+  confQParams.step = 1.0f / 255.0f;
+  QuantizedDetectionFilter filterQ;
+  filterQ.setParams(QuantParams(), confQParams, clsQ, numAnchors, boxDim, true);
+  filterQ.run(&boxQ[0], &confQ[0], &clsQv[0], confThreshold, &boxOut[0], &confOut[0], &clsOut[0]);
+  int clsErrQ = 0;
+  for (int a = 0; a < numAnchors; a++)
+  {
+    if (confOut[a] >= confThreshold)
+      clsErrQ += clsOut[a] != cls[a];
+  }
+
+  printf("anchors %d, above %.2f: float32 %d, fp16 %d\n", numAnchors, confThreshold, passedFloat, passedHalf);
+  printf("bytes per frame:        float32 %zu, fp16 %zu\n",
+    (box.size() + conf.size() + cls.size()) * sizeof(float),
+    (box.size() + conf.size() + cls.size()) * sizeof(uint16_t));
+  printf("                        warm        cold\n");
+  printf("float32 copy + scan:    %.4f ms   %.4f ms\n", msFloat[0], msFloat[1]);
+  printf("fp16 threshold filter:  %.4f ms   %.4f ms\n", msHalf[0], msHalf[1]);
+  printf("fp16 full conversion:   %.4f ms   %.4f ms\n", msHalfFull[0], msHalfFull[1]);
+  printf("threshold flips %d, class mismatches %d (8-bit %d)\n", flipped, clsErr, clsErrQ);
+  printf("max abs error: box %.4f px, conf %.6f\n", maxBoxErr, maxConfErr);
+
+  return clsErr + clsErrQ > 0 ? 1 : 0;
+}
@@ -43,6 +43,7 @@ class BoundingBox
   float distanceToCamera = -1;      // Distance to camera
   float confidence = -1;            // Confidence score
   bool needWarn = 0;
+  bool isPredicted = false;         // True when extrapolated by the tracker instead of detected
   std::vector<cv::KeyPoint> keypoints; // keypoints enclosed by 2D roi
   std::vector<cv::DMatch> kptMatches; // keypoint matches enclosed by 2D roi
   cv::Rect roi; // 2D region-of-interest in image coordinates
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+
+#include "box_head_decoder.hpp"
+
+
+static inline int _clampInt(float v, int maxV)
+{
+  int i = (int)std::lround(v);
+  return i < 0 ? 0 : (i > maxV ? maxV : i);
+}
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+BoxHeadDecoder::BoxHeadDecoder(int inputWidth, int inputHeight, int numClasses)
+{
+  m_inputWidth = inputWidth;
+  m_inputHeight = inputHeight;
+  m_numClasses = numClasses;
+};
+
+
+BoxHeadDecoder::~BoxHeadDecoder()
+{
+};
+
+
+void BoxHeadDecoder::setLayout(int numAnchors, int boxDim, bool boxAnchorMajor)
+{
+  m_numAnchors = numAnchors;
+  m_boxDim = boxDim;
+  m_boxAnchorMajor = boxAnchorMajor;
+}
+
+
+int BoxHeadDecoder::decode(
+  const float *box,
+  const float *conf,
+  const float *cls,
+  float confThreshold,
+  vector<struct v8xyxy> &candidates)
+{
+  candidates.clear();
+  m_lastDropped = 0;
+  if (box == nullptr || conf == nullptr || cls == nullptr || m_boxDim < 4)
+    return 0;
+
+  // Element (anchor, k) of det_box
+  size_t anchorStride = m_boxAnchorMajor ? m_boxDim : 1;
+  size_t valueStride = m_boxAnchorMajor ? 1 : m_numAnchors;
+
+  for (int a = 0; a < m_numAnchors; a++)
+  {
+    if (conf[a] < confThreshold)
+      continue;
+
+    int c = (int)std::lround(cls[a]);
+    if (c < 0 || c >= (m_numClasses > 0 ? m_numClasses : BOX_HEAD_MAX_CLASSES))
+      continue;
+
+    const float *v = box + a * anchorStride;
+    struct v8xyxy b;
+    b.x1 = _clampInt(v[0], m_inputWidth - 1);
+    b.y1 = _clampInt(v[valueStride], m_inputHeight - 1);
+    b.x2 = _clampInt(v[2 * valueStride], m_inputWidth - 1);
+    b.y2 = _clampInt(v[3 * valueStride], m_inputHeight - 1);
+    b.c = c;
+    b.c_prob = conf[a];
+
+    candidates.push_back(b);
+  }
+
+  if (m_maxCandidates > 0 && (int)candidates.size() > m_maxCandidates)
+  {
+    m_lastDropped = (int)candidates.size() - m_maxCandidates;
+    std::nth_element(candidates.begin(), candidates.begin() + m_maxCandidates, candidates.end(),
+      [](const struct v8xyxy &a, const struct v8xyxy &b) { return a.c_prob > b.c_prob; });
+    candidates.resize(m_maxCandidates);
+  }
+
+  return (int)candidates.size();
+}
@@ -0,0 +1,67 @@
+#ifndef __BOX_HEAD_DECODER__
+#define __BOX_HEAD_DECODER__
+
+#include <vector>
+
+#include "yolo_adas_decoder.hpp"
+
+using namespace std;
+
+// Bound on the class ids when the class count isn't known, the NMS keeps
+// per class state up to the highest id
+#define BOX_HEAD_MAX_CLASSES 256
+
+
+// Decodes the detection outputs of a model exported with the box and score
+// post-processing, one entry per candidate of the stride 8, 16 and 32 grids:
+//   det_box   x1, y1, x2, y2 in network input pixels, values past the 4th
+//             are ignored. [anchors, boxDim] or [boxDim, anchors].
+//   det_conf  score of the best class
+//   det_cls   id of the best class, as float
+// Unlike YOLOADAS_Decoder nothing is suppressed or capped by class here, the
+// class thresholds and top-k of the NMS see every candidate.
+class BoxHeadDecoder
+{
+ public:
+  // numClasses 0 when the model doesn't tell, see BOX_HEAD_MAX_CLASSES
+  BoxHeadDecoder(int inputWidth, int inputHeight, int numClasses);
+  ~BoxHeadDecoder();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  // boxAnchorMajor: det_box is [anchors, boxDim], otherwise [boxDim, anchors]
+  void setLayout(int numAnchors, int boxDim, bool boxAnchorMajor);
+
+  // Candidates kept past the threshold, highest scores first, 0 for no
+  // cap. The ones cut by the last decode are counted.
+  void setMaxCandidates(int maxCandidates) { m_maxCandidates = maxCandidates; };
+  int getMaxCandidates() { return m_maxCandidates; };
+  int getLastDropped() { return m_lastDropped; };
+
+  // Candidates above confThreshold in network input coordinates, not yet
+  // suppressed. Returns the number of candidates.
+  int decode(
+    const float *box,
+    const float *conf,
+    const float *cls,
+    float confThreshold,
+    vector<struct v8xyxy> &candidates);
+
+ private:
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  int m_inputWidth = 0;
+  int m_inputHeight = 0;
+  int m_numClasses = 0;
+  int m_numAnchors = 0;
+  int m_boxDim = 0;
+  bool m_boxAnchorMajor = true;
+
+  // Kept before NMS, highest scores first
+  int m_maxCandidates = 1024;
+  int m_lastDropped = 0;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include <algorithm>
+
+#include "box_nms.hpp"
+
+
+// Candidates of the class still wanted: above the threshold, quota not full
+static inline bool _isWanted(const struct v8xyxy &b, const ClassNmsParams &p, const vector<int> &classCount)
+{
+  if (b.c_prob < p.confThreshold)
+    return false;
+
+  return p.topK < 0 || (b.c >= 0 && b.c < (int)classCount.size() && classCount[b.c] < p.topK);
+}
+
+
+static int _numClasses(const vector<struct v8xyxy> &boxes)
+{
+  int maxClass = -1;
+  for (const struct v8xyxy &b : boxes)
+  {
+    maxClass = std::max(maxClass, b.c);
+  }
+
+  return maxClass + 1;
+}
+
+
+/////////////////////////
+// NmsParams
+////////////////////////
+float NmsParams::minConfThreshold() const
+{
+  float conf = defaults.confThreshold;
+  for (const ClassNmsParams &p : classes)
+  {
+    conf = std::min(conf, p.confThreshold);
+  }
+
+  return conf;
+}
+
+
+NmsParams NmsParams::uniform(float iouThreshold)
+{
+  NmsParams params;
+  params.defaults.confThreshold = 0.0f;
+  params.defaults.iouThreshold = iouThreshold;
+  params.defaults.topK = -1;
+
+  return params;
+}
+
+
+/////////////////////////
+// boxNms
+////////////////////////
+float boxNms::iou(const struct v8xyxy &a, const struct v8xyxy &b)
+{
+  int interW = std::min(a.x2, b.x2) - std::max(a.x1, b.x1);
+  int interH = std::min(a.y2, b.y2) - std::max(a.y1, b.y1);
+  if (interW <= 0 || interH <= 0)
+    return 0.0f;
+
+  float inter = (float)interW * interH;
+  float areaA = (float)(a.x2 - a.x1) * (a.y2 - a.y1);
+  float areaB = (float)(b.x2 - b.x1) * (b.y2 - b.y1);
+
+  return inter / (areaA + areaB - inter);
+}
+
+
+void boxNms::sortByScore(vector<struct v8xyxy> &boxes)
+{
+  std::stable_sort(boxes.begin(), boxes.end(),
+    [](const struct v8xyxy &a, const struct v8xyxy &b) { return a.c_prob > b.c_prob; });
+}
+
+
+int boxNms::pairwise(vector<struct v8xyxy> &boxes, const NmsParams &params, struct v8xyxy *out, int maxOut)
+{
+  sortByScore(boxes);
+
+  vector<int> classCount(_numClasses(boxes), 0);
+  vector<bool> suppressed(boxes.size(), false);
+  int numOut = 0;
+  for (size_t i = 0; i < boxes.size() && numOut < maxOut; i++)
+  {
+    const ClassNmsParams &p = params.get(boxes[i].c);
+    if (suppressed[i] || !_isWanted(boxes[i], p, classCount))
+      continue;
+
+    out[numOut++] = boxes[i];
+    if (boxes[i].c >= 0)
+      classCount[boxes[i].c]++;
+
+    for (size_t j = i + 1; j < boxes.size(); j++)
+    {
+      if (!suppressed[j] && boxes[j].c == boxes[i].c && iou(boxes[i], boxes[j]) > p.iouThreshold)
+        suppressed[j] = true;
+    }
+  }
+
+  return numOut;
+}
+
+
+int boxNms::pairwise(vector<struct v8xyxy> &boxes, float iouThreshold, struct v8xyxy *out, int maxOut)
+{
+  return pairwise(boxes, NmsParams::uniform(iouThreshold), out, maxOut);
+}
+
+
+/////////////////////////
+// GridNms
+////////////////////////
+GridNms::GridNms()
+{
+};
+
+
+GridNms::~GridNms()
+{
+};
+
+
+int GridNms::run(vector<struct v8xyxy> &boxes, const NmsParams &params, struct v8xyxy *out, int maxOut)
+{
+  if (boxes.empty() || maxOut <= 0)
+    return 0;
+
+  boxNms::sortByScore(boxes);
+
+  // Grid over the candidates' extent
+  int minX = boxes[0].x1, minY = boxes[0].y1;
+  int maxX = boxes[0].x2, maxY = boxes[0].y2;
+  for (const struct v8xyxy &b : boxes)
+  {
+    minX = std::min(minX, b.x1);
+    minY = std::min(minY, b.y1);
+    maxX = std::max(maxX, b.x2);
+    maxY = std::max(maxY, b.y2);
+  }
+
+  int extent = std::max(maxX - minX, maxY - minY);
+  int cellSize = std::max(m_minCellSize, extent / m_maxCellsPerSide + 1);
+  int gridW = (maxX - minX) / cellSize + 1;
+  int gridH = (maxY - minY) / cellSize + 1;
+  int numClasses = _numClasses(boxes);
+  size_t numCells = (size_t)gridW * gridH * std::max(numClasses, 1);
+
+  m_cells.resize(std::max(numCells, m_cells.size()));
+  for (size_t i = 0; i < numCells; i++)
+  {
+    m_cells[i].clear();
+  }
+  m_classCount.assign(std::max(numClasses, 0), 0);
+
+  int numOut = 0;
+  for (size_t i = 0; i < boxes.size() && numOut < maxOut; i++)
+  {
+    const struct v8xyxy &b = boxes[i];
+    const ClassNmsParams &p = params.get(b.c);
+    if (!_isWanted(b, p, m_classCount))
+      continue;
+
+    // Boxes of a negative class share the cells of class 0 and are told
+    // apart by the class test
+    int classOffset = std::max(b.c, 0) * gridH;
+    int cx0 = (b.x1 - minX) / cellSize;
+    int cy0 = (b.y1 - minY) / cellSize;
+    int cx1 = (b.x2 - minX) / cellSize;
+    int cy1 = (b.y2 - minY) / cellSize;
+
+    bool keep = true;
+    for (int cy = cy0; cy <= cy1 && keep; cy++)
+    {
+      for (int cx = cx0; cx <= cx1 && keep; cx++)
+      {
+        for (int k : m_cells[(classOffset + cy) * gridW + cx])
+        {
+          if (out[k].c == b.c && boxNms::iou(out[k], b) > p.iouThreshold)
+          {
+            keep = false;
+            break;
+          }
+        }
+      }
+    }
+
+    if (!keep)
+      continue;
+
+    out[numOut] = b;
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+      for (int cx = cx0; cx <= cx1; cx++)
+      {
+        m_cells[(classOffset + cy) * gridW + cx].push_back(numOut);
+      }
+    }
+    if (b.c >= 0)
+      m_classCount[b.c]++;
+    numOut++;
+  }
+
+  return numOut;
+}
+
+
+int GridNms::run(vector<struct v8xyxy> &boxes, float iouThreshold, struct v8xyxy *out, int maxOut)
+{
+  return run(boxes, NmsParams::uniform(iouThreshold), out, maxOut);
+}
@@ -0,0 +1,95 @@
+#ifndef __BOX_NMS__
+#define __BOX_NMS__
+
+#include <vector>
+
+#include "yolo_adas_decoder.hpp"
+
+using namespace std;
+
+
+enum NmsMethod
+{
+  NMS_PAIRWISE = 0,   // every candidate against every kept box
+  NMS_GRID = 1        // only against kept boxes in the same grid cells
+};
+
+
+// Thresholds and quota of one class
+struct ClassNmsParams
+{
+  float confThreshold = 0.0f;
+  float iouThreshold = 0.5f;
+  int topK = -1;              // kept boxes of the class at most, -1 for no cap
+};
+
+
+// Per class parameters, classes without an entry use defaults
+struct NmsParams
+{
+  vector<ClassNmsParams> classes;
+  ClassNmsParams defaults;
+
+  const ClassNmsParams &get(int classId) const
+  {
+    return (classId >= 0 && classId < (int)classes.size()) ? classes[classId] : defaults;
+  };
+
+  // Loosest confidence threshold over all classes, for the decoding
+  float minConfThreshold() const;
+
+  // Same IoU threshold for every class, no confidence threshold or quota
+  static NmsParams uniform(float iouThreshold);
+};
+
+
+// Greedy class-aware NMS over v8xyxy boxes, all classes in one pass over
+// the candidates sorted by confidence. Candidates below their class'
+// confidence threshold are dropped, and once a class has topK boxes its
+// other candidates are skipped. Both methods keep exactly the same boxes,
+// the grid only skips IoU tests between boxes that can't overlap.
+namespace boxNms
+{
+  float iou(const struct v8xyxy &a, const struct v8xyxy &b);
+
+  // Highest confidence first, the order both methods process boxes in
+  void sortByScore(vector<struct v8xyxy> &boxes);
+
+  // boxes are sorted in place, returns the number of boxes written to out
+  int pairwise(vector<struct v8xyxy> &boxes, const NmsParams &params, struct v8xyxy *out, int maxOut);
+  int pairwise(vector<struct v8xyxy> &boxes, float iouThreshold, struct v8xyxy *out, int maxOut);
+}
+
+
+// Kept boxes are binned into a coarse grid over the area the candidates
+// span, each in every cell it covers. Every class has its own cells (the
+// class offsets the cell index), so a candidate is only tested against the
+// kept boxes of its class in the cells it covers; boxes without a common
+// cell don't overlap.
+class GridNms
+{
+ public:
+  GridNms();
+  ~GridNms();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  // Same contract as boxNms::pairwise
+  int run(vector<struct v8xyxy> &boxes, const NmsParams &params, struct v8xyxy *out, int maxOut);
+  int run(vector<struct v8xyxy> &boxes, float iouThreshold, struct v8xyxy *out, int maxOut);
+
+ private:
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  int m_maxCellsPerSide = 32;
+  int m_minCellSize = 16;
+
+  // Indices into out per class and cell, kept between calls to reuse the
+  // storage
+  vector<vector<int>> m_cells;
+  vector<int> m_classCount;
+};
+
+#endif
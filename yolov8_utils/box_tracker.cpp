@@ -0,0 +1,185 @@
+
+#include "box_tracker.hpp"
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+BoxTracker::BoxTracker(int imgW, int imgH)
+{
+  m_imgW = imgW;
+  m_imgH = imgH;
+};
+
+
+BoxTracker::~BoxTracker()
+{};
+
+
+void BoxTracker::update(vector<BoundingBox> &detBoxList, int frameStamp)
+{
+  vector<bool> detMatched(detBoxList.size(), false);
+  float motionSum = 0;
+  int motionCount = 0;
+
+  // Associate each track with the detection overlapping its predicted position
+  for (int i=0; i<(int)m_objectList.size(); i++)
+  {
+    Object &obj = m_objectList[i];
+    BoundingBox predBox = _predNextBoundingBox(obj, frameStamp);
+    int bestIdx = -1;
+    float bestIoU = m_iouThreshold;
+
+    for (int j=0; j<(int)detBoxList.size(); j++)
+    {
+      if (detMatched[j] || detBoxList[j].label != obj.bbox.label)
+        continue;
+
+      float iou = _getIoU(predBox, detBoxList[j]);
+      if (iou > bestIoU)
+      {
+        bestIoU = iou;
+        bestIdx = j;
+      }
+    }
+
+    if (bestIdx < 0)
+    {
+      obj.disappearCounter += 1;
+      continue;
+    }
+
+    BoundingBox detBox = detBoxList[bestIdx];
+    detBox.frameStamp = frameStamp;
+    detBox.objID = obj.id;
+    detMatched[bestIdx] = true;
+
+    int frameInterval = frameStamp - obj.bbox.frameStamp;
+    if (frameInterval > 0 && obj.bbox.getHeight() > 0)
+    {
+      float dx = (detBox.x1 + detBox.x2 - obj.bbox.x1 - obj.bbox.x2) * 0.5;
+      float dy = (detBox.y1 + detBox.y2 - obj.bbox.y1 - obj.bbox.y2) * 0.5;
+      motionSum += sqrt(dx*dx + dy*dy) / (float)frameInterval / (float)obj.bbox.getHeight();
+      motionCount += 1;
+    }
+
+    obj.updateBoundingBox(detBox);
+    obj.bboxList.push_back(detBox);
+    if ((int)obj.bboxList.size() > m_historySize)
+      obj.bboxList.erase(obj.bboxList.begin());
+    obj.disappearCounter = 0;
+    obj.aliveCounter += 1;
+  }
+
+  // Drop tracks which have not been detected for a while
+  for (int i=(int)m_objectList.size()-1; i>=0; i--)
+  {
+    if (m_objectList[i].disappearCounter > m_maxDisappear)
+      m_objectList.erase(m_objectList.begin() + i);
+  }
+
+  // New tracks for unmatched detections
+  for (int j=0; j<(int)detBoxList.size(); j++)
+  {
+    if (detMatched[j])
+      continue;
+
+    Object obj;
+    obj.init(frameStamp);
+    obj.id = m_nextID++;
+    obj.updateStatus(1);
+
+    BoundingBox detBox = detBoxList[j];
+    detBox.frameStamp = frameStamp;
+    detBox.objID = obj.id;
+    obj.updateBoundingBox(detBox);
+    obj.bboxList.push_back(detBox);
+    obj.aliveCounter = 1;
+    m_objectList.push_back(obj);
+  }
+
+  if (motionCount > 0)
+    m_motion = 0.5 * m_motion + 0.5 * (motionSum / (float)motionCount);
+}
+
+
+void BoxTracker::predict(vector<BoundingBox> &predBoxList, int frameStamp)
+{
+  for (int i=0; i<(int)m_objectList.size(); i++)
+  {
+    Object &obj = m_objectList[i];
+    if (obj.disappearCounter > 0)
+      continue;
+
+    BoundingBox predBox = _predNextBoundingBox(obj, frameStamp);
+    predBox.objID = obj.id;
+    predBox.confidence = obj.bbox.confidence;
+    predBox.isPredicted = true;
+    predBoxList.push_back(predBox);
+  }
+}
+
+
+float BoxTracker::getMotion()
+{
+  return m_motion;
+}
+
+
+int BoxTracker::getTrackNum()
+{
+  return (int)m_objectList.size();
+}
+
+
+/////////////////////////
+// private member functions
+////////////////////////
+BoundingBox BoxTracker::_predNextBoundingBox(Object &obj, int frameStamp)
+{
+  BoundingBox lastBox = obj.bbox;
+  if (obj.bboxList.size() < 2)
+    return lastBox;
+
+  // Constant velocity of center and size over the detection history,
+  // the same model Object::predNextBoundingBox uses, but per frame so that
+  // it holds between detections spaced several frames apart.
+  BoundingBox &firstBox = obj.bboxList.front();
+  int dt = lastBox.frameStamp - firstBox.frameStamp;
+  int steps = frameStamp - lastBox.frameStamp;
+  if (dt <= 0 || steps <= 0)
+    return lastBox;
+
+  float velX = ((lastBox.x1 + lastBox.x2) - (firstBox.x1 + firstBox.x2)) * 0.5 / (float)dt;
+  float velY = ((lastBox.y1 + lastBox.y2) - (firstBox.y1 + firstBox.y2)) * 0.5 / (float)dt;
+  float velW = ((lastBox.x2 - lastBox.x1) - (firstBox.x2 - firstBox.x1)) / (float)dt;
+  float velH = ((lastBox.y2 - lastBox.y1) - (firstBox.y2 - firstBox.y1)) / (float)dt;
+
+  float cx = (lastBox.x1 + lastBox.x2) * 0.5 + velX * steps;
+  float cy = (lastBox.y1 + lastBox.y2) * 0.5 + velY * steps;
+  float w = max((lastBox.x2 - lastBox.x1) + velW * steps, 1.0f);
+  float h = max((lastBox.y2 - lastBox.y1) + velH * steps, 1.0f);
+
+  float x1 = min(max(cx - w * 0.5f, 0.0f), (float)(m_imgW - 1));
+  float y1 = min(max(cy - h * 0.5f, 0.0f), (float)(m_imgH - 1));
+  float x2 = min(max(cx + w * 0.5f, 0.0f), (float)(m_imgW - 1));
+  float y2 = min(max(cy + h * 0.5f, 0.0f), (float)(m_imgH - 1));
+
+  BoundingBox predBox(x1, y1, x2, y2, lastBox.label);
+  predBox.frameStamp = frameStamp;
+  return predBox;
+}
+
+
+float BoxTracker::_getIoU(BoundingBox &boxA, BoundingBox &boxB)
+{
+  float interW = min(boxA.x2, boxB.x2) - max(boxA.x1, boxB.x1);
+  float interH = min(boxA.y2, boxB.y2) - max(boxA.y1, boxB.y1);
+  if (interW <= 0 || interH <= 0)
+    return 0;
+
+  float interArea = interW * interH;
+  float areaA = (boxA.x2 - boxA.x1) * (boxA.y2 - boxA.y1);
+  float areaB = (boxB.x2 - boxB.x1) * (boxB.y2 - boxB.y1);
+  return interArea / (areaA + areaB - interArea);
+}
@@ -0,0 +1,53 @@
+#ifndef __BOX_TRACKER__
+#define __BOX_TRACKER__
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+#include "point.hpp"
+#include "bounding_box.hpp"
+#include "object.hpp"
+
+using namespace std;
+
+
+class BoxTracker
+{
+ public:
+  BoxTracker(int imgW, int imgH);
+  ~BoxTracker();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  void update(vector<BoundingBox> &detBoxList, int frameStamp);
+  void predict(vector<BoundingBox> &predBoxList, int frameStamp);
+  float getMotion();
+  int getTrackNum();
+
+ private:
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  BoundingBox _predNextBoundingBox(Object &obj, int frameStamp);
+  float _getIoU(BoundingBox &boxA, BoundingBox &boxB);
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  vector<Object> m_objectList;
+  int m_nextID = 0;
+  int m_imgW = 0;
+  int m_imgH = 0;
+
+  // Center displacement per frame, normalized by box height (EMA)
+  float m_motion = 0;
+
+  // Threshold
+  float m_iouThreshold = 0.3;
+  int m_maxDisappear = 2;         // Detection rounds a track survives unmatched
+  int m_historySize = 4;          // Detections kept for velocity estimation
+};
+
+#endif
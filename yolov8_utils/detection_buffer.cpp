@@ -0,0 +1,50 @@
+#include <algorithm>
+
+#include "detection_buffer.hpp"
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+DetectionBuffer::DetectionBuffer()
+{
+};
+
+
+DetectionBuffer::~DetectionBuffer()
+{
+};
+
+
+void DetectionBuffer::setCapacity(int capacity)
+{
+  m_boxes.assign(std::max(capacity, 0), v8xyxy());
+  m_size = 0;
+  m_lastOverflow = 0;
+  m_totalOverflow = 0;
+}
+
+
+int DetectionBuffer::assign(const struct v8xyxy *boxes, int count, bool sortedByScore, bool countOverflow, int dropped)
+{
+  int cap = capacity();
+  if (countOverflow)
+  {
+    m_lastOverflow = std::max(count - cap, 0) + dropped;
+    m_totalOverflow += m_lastOverflow;
+  }
+
+  if (sortedByScore || count <= cap)
+  {
+    m_size = std::min(count, cap);
+    std::copy(boxes, boxes + m_size, m_boxes.begin());
+  }
+  else
+  {
+    // Best cap boxes only, in score order
+    m_size = (int)(std::partial_sort_copy(boxes, boxes + count, m_boxes.begin(), m_boxes.end(),
+      [](const struct v8xyxy &a, const struct v8xyxy &b) { return a.c_prob > b.c_prob; }) - m_boxes.begin());
+  }
+
+  return m_size;
+}
@@ -0,0 +1,55 @@
+#ifndef __DETECTION_BUFFER__
+#define __DETECTION_BUFFER__
+
+#include <stdint.h>
+#include <vector>
+
+#include "yolo_adas_decoder.hpp"
+
+using namespace std;
+
+
+// Detections of one frame, allocated once for a fixed capacity. When more
+// boxes come in than fit, the lowest scores are dropped and counted.
+class DetectionBuffer
+{
+ public:
+  DetectionBuffer();
+  ~DetectionBuffer();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  void setCapacity(int capacity);
+  int capacity() const { return (int)m_boxes.size(); };
+  int size() const { return m_size; };
+  void clear() { m_size = 0; };
+
+  struct v8xyxy *data() { return m_boxes.data(); };
+  struct v8xyxy &operator[](int i) { return m_boxes[i]; };
+  const struct v8xyxy &operator[](int i) const { return m_boxes[i]; };
+
+  // Replaces the content with boxes, or when they don't fit with the best
+  // capacity() of them in score order. Pass sortedByScore when boxes
+  // already are, they are then simply cut. Without countOverflow the
+  // dropped boxes aren't counted, for a content that is replaced again
+  // within the same frame. Returns size().
+  // dropped: boxes already cut before (the decoder candidate cap), counted
+  // along with the overflow.
+  int assign(const struct v8xyxy *boxes, int count, bool sortedByScore, bool countOverflow, int dropped = 0);
+
+  // Boxes dropped by the last counted assign, and since setCapacity
+  int getLastOverflow() const { return m_lastOverflow; };
+  uint64_t getTotalOverflow() const { return m_totalOverflow; };
+
+ private:
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  vector<struct v8xyxy> m_boxes;
+  int m_size = 0;
+  int m_lastOverflow = 0;
+  uint64_t m_totalOverflow = 0;
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <iostream>
+
+#include "frame_dataset.hpp"
+
+
+static int64_t _nowUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static uint64_t _alignUp(uint64_t size)
+{
+  return (size + FRAME_DATASET_ALIGN - 1) / FRAME_DATASET_ALIGN * FRAME_DATASET_ALIGN;
+}
+
+
+/////////////////////////
+// FrameDatasetWriter
+////////////////////////
+FrameDatasetWriter::FrameDatasetWriter(const string &filePath)
+{
+  m_filePath = filePath;
+  memset(&m_header, 0, sizeof(m_header));
+};
+
+
+FrameDatasetWriter::~FrameDatasetWriter()
+{
+  close();
+};
+
+
+bool FrameDatasetWriter::isOpen()
+{
+  return m_file != nullptr;
+}
+
+
+uint64_t FrameDatasetWriter::getFrameCount()
+{
+  return m_index.size();
+}
+
+
+bool FrameDatasetWriter::write(const cv::Mat &frame, int64_t timestampUs)
+{
+  if (frame.empty() || m_failed)
+    return false;
+
+  // Shape and pixel format are fixed by the first frame
+  if (m_file == nullptr)
+  {
+    if (!m_index.empty() || !_writeHeader(frame))
+      return false;
+  }
+
+  if (frame.cols != (int)m_header.width || frame.rows != (int)m_header.height ||
+      frame.type() != (int)m_header.cvType)
+  {
+    cerr << "[FrameDataset] frame " << frame.cols << "x" << frame.rows
+         << " doesn't match " << m_header.width << "x" << m_header.height << endl;
+    return false;
+  }
+
+  FrameDatasetIndex index;
+  index.offset = m_header.dataOffset + m_index.size() * m_header.frameSize;
+  index.timestampUs = timestampUs >= 0 ? timestampUs : _nowUs();
+
+  // A short write leaves the file position off the fixed stride, the
+  // frames written so far are kept but nothing is appended anymore
+  size_t rowBytes = frame.cols * frame.elemSize();
+  bool ok = true;
+  if (frame.isContinuous())
+  {
+    ok = fwrite(frame.data, 1, rowBytes * frame.rows, m_file) == rowBytes * frame.rows;
+  }
+  else
+  {
+    for (int y = 0; y < frame.rows && ok; y++)
+    {
+      ok = fwrite(frame.ptr(y), 1, rowBytes, m_file) == rowBytes;
+    }
+  }
+
+  size_t padBytes = m_header.frameSize - rowBytes * frame.rows;
+  if (ok && padBytes > 0)
+    ok = fwrite(&m_padding[0], 1, padBytes, m_file) == padBytes;
+
+  if (!ok)
+  {
+    cerr << "[FrameDataset] short write to " << m_filePath << ", keeping "
+         << m_index.size() << " frames" << endl;
+    m_failed = true;
+    return false;
+  }
+
+  m_index.push_back(index);
+
+  return true;
+}
+
+
+bool FrameDatasetWriter::close()
+{
+  if (m_file == nullptr)
+    return true;
+
+  bool ret = true;
+
+  // Index goes after the last frame, then the header is patched with it
+  m_header.frameCount = m_index.size();
+  m_header.indexOffset = m_header.dataOffset + m_header.frameCount * m_header.frameSize;
+  if (fseeko(m_file, (off_t)m_header.indexOffset, SEEK_SET) != 0 ||
+      (!m_index.empty() &&
+       fwrite(&m_index[0], sizeof(FrameDatasetIndex), m_index.size(), m_file) != m_index.size()))
+    ret = false;
+
+  if (fseek(m_file, 0, SEEK_SET) != 0 ||
+      fwrite(&m_header, sizeof(m_header), 1, m_file) != 1)
+    ret = false;
+
+  fclose(m_file);
+  m_file = nullptr;
+
+  return ret;
+}
+
+
+bool FrameDatasetWriter::_writeHeader(const cv::Mat &frame)
+{
+  m_file = fopen(m_filePath.c_str(), "wb");
+  if (m_file == nullptr)
+  {
+    cerr << "[FrameDataset] can't create " << m_filePath << endl;
+    return false;
+  }
+
+  memcpy(m_header.magic, FRAME_DATASET_MAGIC, sizeof(m_header.magic));
+  m_header.version = FRAME_DATASET_VERSION;
+  m_header.pixelFormat = frame.channels() == 1 ? PIXFMT_GRAY8 : PIXFMT_BGR24;
+  m_header.width = frame.cols;
+  m_header.height = frame.rows;
+  m_header.cvType = frame.type();
+  m_header.stride = frame.cols * frame.elemSize();
+  m_header.frameSize = _alignUp(m_header.stride * frame.rows);
+  m_header.dataOffset = FRAME_DATASET_ALIGN;
+  m_padding.assign(m_header.frameSize - m_header.stride * frame.rows, 0);
+
+  // Placeholder header (indexOffset 0), rewritten with count and index on
+  // close()
+  vector<uint8_t> head(m_header.dataOffset, 0);
+  memcpy(&head[0], &m_header, sizeof(m_header));
+  if (fwrite(&head[0], 1, head.size(), m_file) != head.size())
+  {
+    fclose(m_file);
+    m_file = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+
+/////////////////////////
+// FrameDatasetReader
+////////////////////////
+FrameDatasetReader::FrameDatasetReader()
+{
+  memset(&m_header, 0, sizeof(m_header));
+};
+
+
+FrameDatasetReader::~FrameDatasetReader()
+{
+  close();
+};
+
+
+bool FrameDatasetReader::open(const string &filePath)
+{
+  struct stat st;
+
+  close();
+  m_fd = ::open(filePath.c_str(), O_RDONLY);
+  if (m_fd < 0 || fstat(m_fd, &st) != 0 || (size_t)st.st_size < sizeof(m_header))
+  {
+    cerr << "[FrameDataset] can't open " << filePath << endl;
+    close();
+    return false;
+  }
+
+  // Private writable mapping: frames are handed out as cv::Mat views and the
+  // preprocessing may modify them in place, pages are only copied on write.
+  m_mapSize = st.st_size;
+  void *map = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd, 0);
+  if (map == MAP_FAILED)
+  {
+    cerr << "[FrameDataset] can't map " << filePath << endl;
+    close();
+    return false;
+  }
+  m_map = (uint8_t *)map;
+  madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+
+  memcpy(&m_header, m_map, sizeof(m_header));
+  if (memcmp(m_header.magic, FRAME_DATASET_MAGIC, sizeof(m_header.magic)) != 0 ||
+      m_header.version != FRAME_DATASET_VERSION ||
+      m_header.dataOffset < sizeof(m_header) || m_header.dataOffset > m_mapSize ||
+      m_header.frameSize == 0 || m_header.frameSize < m_header.stride * m_header.height ||
+      m_header.stride < m_header.width * CV_ELEM_SIZE(m_header.cvType))
+  {
+    cerr << "[FrameDataset] " << filePath << " is not a frame dataset" << endl;
+    close();
+    return false;
+  }
+
+  if (m_header.indexOffset == 0)
+  {
+    // Never closed: the frames are where the fixed stride puts them, as
+    // many as are complete on disk, without capture times
+    m_header.frameCount = (m_mapSize - m_header.dataOffset) / m_header.frameSize;
+    m_recoveredIndex.resize(m_header.frameCount);
+    for (uint64_t i = 0; i < m_header.frameCount; i++)
+    {
+      m_recoveredIndex[i].offset = m_header.dataOffset + i * m_header.frameSize;
+      m_recoveredIndex[i].timestampUs = -1;
+    }
+    m_index = m_recoveredIndex.data();
+    cerr << "[FrameDataset] " << filePath << " was not closed, recovered "
+         << m_header.frameCount << " frames" << endl;
+    return true;
+  }
+
+  if (m_header.indexOffset > m_mapSize ||
+      m_header.frameCount > (m_mapSize - m_header.indexOffset) / sizeof(FrameDatasetIndex))
+  {
+    cerr << "[FrameDataset] " << filePath << " is not a complete frame dataset" << endl;
+    close();
+    return false;
+  }
+  m_index = (const FrameDatasetIndex *)(m_map + m_header.indexOffset);
+
+  // Every frame has to lie inside the file, getFrame trusts the index
+  for (uint64_t i = 0; i < m_header.frameCount; i++)
+  {
+    if (m_index[i].offset < m_header.dataOffset || m_index[i].offset > m_mapSize ||
+        m_header.frameSize > m_mapSize - m_index[i].offset)
+    {
+      cerr << "[FrameDataset] " << filePath << ": frame " << i << " is out of the file" << endl;
+      close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+void FrameDatasetReader::close()
+{
+  if (m_map != nullptr)
+    munmap(m_map, m_mapSize);
+  if (m_fd >= 0)
+    ::close(m_fd);
+
+  m_map = nullptr;
+  m_mapSize = 0;
+  m_fd = -1;
+  m_index = nullptr;
+  m_recoveredIndex.clear();
+  memset(&m_header, 0, sizeof(m_header));
+}
+
+
+bool FrameDatasetReader::getFrame(uint64_t frameIdx, cv::Mat &frame)
+{
+  if (m_map == nullptr || frameIdx >= m_header.frameCount)
+    return false;
+
+  frame = cv::Mat(m_header.height, m_header.width, m_header.cvType,
+    m_map + m_index[frameIdx].offset, m_header.stride);
+
+  return true;
+}
+
+
+int64_t FrameDatasetReader::getTimestamp(uint64_t frameIdx)
+{
+  if (m_map == nullptr || frameIdx >= m_header.frameCount)
+    return -1;
+
+  return m_index[frameIdx].timestampUs;
+}
+
+
+uint64_t FrameDatasetReader::getFrameCount()
+{
+  return m_header.frameCount;
+}
+
+
+int FrameDatasetReader::getWidth()
+{
+  return m_header.width;
+}
+
+
+int FrameDatasetReader::getHeight()
+{
+  return m_header.height;
+}
+
+
+int FrameDatasetReader::getPixelFormat()
+{
+  return m_header.pixelFormat;
+}
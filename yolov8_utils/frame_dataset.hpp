@@ -0,0 +1,120 @@
+#ifndef __FRAME_DATASET__
+#define __FRAME_DATASET__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+
+// Raw frame container for replay and benchmarking:
+//   [header][frame 0][frame 1]...[frame N-1][index]
+// Frames have a fixed stride (page aligned) so frame i lives at
+// dataOffset + i * frameSize, the index keeps offset and capture time.
+// Until close() the header has indexOffset 0, a file left that way (the
+// writer was killed) is opened with the complete frames found on disk.
+#define FRAME_DATASET_MAGIC "WNCFRAME"
+#define FRAME_DATASET_VERSION 1
+#define FRAME_DATASET_ALIGN 4096
+
+enum FramePixelFormat
+{
+  PIXFMT_BGR24 = 0,
+  PIXFMT_GRAY8 = 1
+};
+
+struct FrameDatasetHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t pixelFormat;
+  uint32_t width;
+  uint32_t height;
+  uint32_t cvType;
+  uint32_t reserved;
+  uint64_t stride;       // bytes per row
+  uint64_t frameSize;    // bytes per frame, including alignment padding
+  uint64_t frameCount;
+  uint64_t dataOffset;
+  uint64_t indexOffset;
+};
+
+struct FrameDatasetIndex
+{
+  uint64_t offset;
+  int64_t timestampUs;
+};
+
+
+class FrameDatasetWriter
+{
+ public:
+  FrameDatasetWriter(const string &filePath);
+  ~FrameDatasetWriter();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  bool write(const cv::Mat &frame, int64_t timestampUs = -1);
+  bool close();
+  bool isOpen();
+  uint64_t getFrameCount();
+
+ private:
+  bool _writeHeader(const cv::Mat &frame);
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  string m_filePath;
+  FILE *m_file = nullptr;
+  FrameDatasetHeader m_header;
+  vector<FrameDatasetIndex> m_index;
+  vector<uint8_t> m_padding;
+
+  // Set by a short write, the frames after it would be misplaced
+  bool m_failed = false;
+};
+
+
+class FrameDatasetReader
+{
+ public:
+  FrameDatasetReader();
+  ~FrameDatasetReader();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  bool open(const string &filePath);
+  void close();
+
+  // Zero-copy view into the mapping, valid until close()
+  bool getFrame(uint64_t frameIdx, cv::Mat &frame);
+  int64_t getTimestamp(uint64_t frameIdx);
+
+  uint64_t getFrameCount();
+  int getWidth();
+  int getHeight();
+  int getPixelFormat();
+
+ private:
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  int m_fd = -1;
+  uint8_t *m_map = nullptr;
+  size_t m_mapSize = 0;
+  FrameDatasetHeader m_header;
+  const FrameDatasetIndex *m_index = nullptr;
+
+  // Index rebuilt from the fixed stride for a file that wasn't closed
+  vector<FrameDatasetIndex> m_recoveredIndex;
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include <algorithm>
+
+#include "img_convert.hpp"
+#include "fused_preprocess.hpp"
+
+
+// Bilinear weights, same precision as OpenCV's INTER_LINEAR
+#define RESIZE_COEF_BITS 11
+#define RESIZE_COEF_ONE (1 << RESIZE_COEF_BITS)
+
+
+static inline int _clip(int v)
+{
+  return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+
+static inline int _bilinear(int p00, int p01, int p10, int p11, int wx, int wy)
+{
+  int top = p00 * (RESIZE_COEF_ONE - wx) + p01 * wx;
+  int bot = p10 * (RESIZE_COEF_ONE - wx) + p11 * wx;
+  return (top * (RESIZE_COEF_ONE - wy) + bot * wy + (1 << (2 * RESIZE_COEF_BITS - 1)))
+    >> (2 * RESIZE_COEF_BITS);
+}
+
+
+template <typename T>
+static inline void _storeRGB(T *dst, size_t idx, size_t planeSize, PreprocLayout layout, T r, T g, T b)
+{
+  if (layout == PREPROC_NHWC)
+  {
+    dst[3 * idx] = r;
+    dst[3 * idx + 1] = g;
+    dst[3 * idx + 2] = b;
+  }
+  else
+  {
+    dst[idx] = r;
+    dst[planeSize + idx] = g;
+    dst[2 * planeSize + idx] = b;
+  }
+}
+
+
+/////////////////////////
+// LetterboxTransform
+////////////////////////
+LetterboxTransform LetterboxTransform::make(cv::Size srcSize, cv::Size dstSize, bool letterbox)
+{
+  LetterboxTransform t;
+  if (srcSize.width <= 0 || srcSize.height <= 0)
+    return t;
+
+  int imgWidth = dstSize.width;
+  int imgHeight = dstSize.height;
+  if (letterbox)
+  {
+    float scale = std::min(
+      (float)dstSize.width / srcSize.width, (float)dstSize.height / srcSize.height);
+    imgWidth = std::max(1, std::min((int)(srcSize.width * scale + 0.5f), dstSize.width));
+    imgHeight = std::max(1, std::min((int)(srcSize.height * scale + 0.5f), dstSize.height));
+    t.padX = (float)((dstSize.width - imgWidth) / 2);
+    t.padY = (float)((dstSize.height - imgHeight) / 2);
+  }
+
+  t.scaleX = (float)imgWidth / srcSize.width;
+  t.scaleY = (float)imgHeight / srcSize.height;
+
+  return t;
+}
+
+
+cv::Point2f LetterboxTransform::forward(const cv::Point2f &p) const
+{
+  return cv::Point2f(forwardX(p.x), forwardY(p.y));
+}
+
+
+cv::Rect2f LetterboxTransform::forwardBox(const cv::Rect2f &box) const
+{
+  return cv::Rect2f(forwardX(box.x), forwardY(box.y), box.width * scaleX, box.height * scaleY);
+}
+
+
+cv::Point2f LetterboxTransform::inverse(const cv::Point2f &p) const
+{
+  return cv::Point2f(inverseX(p.x), inverseY(p.y));
+}
+
+
+cv::Rect2f LetterboxTransform::inverseBox(const cv::Rect2f &box) const
+{
+  return cv::Rect2f(inverseX(box.x), inverseY(box.y), box.width / scaleX, box.height / scaleY);
+}
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+FusedPreprocessor::FusedPreprocessor(int dstWidth, int dstHeight, PreprocLayout layout)
+{
+  m_dstWidth = dstWidth;
+  m_dstHeight = dstHeight;
+  m_layout = layout;
+
+  setEnhancementLUT(cv::Mat());
+};
+
+
+FusedPreprocessor::~FusedPreprocessor()
+{
+};
+
+
+void FusedPreprocessor::setLetterbox(bool enable, uint8_t padValue)
+{
+  m_letterbox = enable;
+  m_padValue = padValue;
+}
+
+
+void FusedPreprocessor::setEnhancementLUT(const cv::Mat &lut)
+{
+  bool identity = lut.empty() || lut.type() != CV_8UC3 || lut.total() != 256;
+  const uint8_t *bgr = identity ? nullptr : lut.ptr<uint8_t>(0);
+
+  for (int c = 0; c < 3; c++)
+  {
+    // Output channel c (RGB) comes from table channel 2 - c (BGR)
+    for (int i = 0; i < 256; i++)
+    {
+      uint8_t v = identity ? (uint8_t)i : bgr[3 * i + 2 - c];
+      m_normLUT[c][i] = v / 255.0f;
+      m_u8LUT[c][i] = v;
+    }
+  }
+}
+
+
+bool FusedPreprocessor::runNV12(
+  const uint8_t *y,
+  size_t yPitch,
+  const uint8_t *uv,
+  size_t uvPitch,
+  int width,
+  int height,
+  float *dst)
+{
+  return _runNV12(y, yPitch, uv, uvPitch, width, height, dst, m_normLUT, m_padValue / 255.0f);
+}
+
+
+bool FusedPreprocessor::runNV12(
+  const uint8_t *y,
+  size_t yPitch,
+  const uint8_t *uv,
+  size_t uvPitch,
+  int width,
+  int height,
+  uint8_t *dst)
+{
+  return _runNV12(y, yPitch, uv, uvPitch, width, height, dst, m_u8LUT, m_padValue);
+}
+
+
+bool FusedPreprocessor::runBGR(const cv::Mat &src, float *dst)
+{
+  return _runBGR(src, dst, m_normLUT, m_padValue / 255.0f);
+}
+
+
+bool FusedPreprocessor::runBGR(const cv::Mat &src, uint8_t *dst)
+{
+  return _runBGR(src, dst, m_u8LUT, m_padValue);
+}
+
+
+/////////////////////////
+// private member functions
+////////////////////////
+template <typename T>
+bool FusedPreprocessor::_runNV12(
+  const uint8_t *y,
+  size_t yPitch,
+  const uint8_t *uv,
+  size_t uvPitch,
+  int width,
+  int height,
+  T *dst,
+  const T (*lut)[256],
+  T pad)
+{
+  if (y == nullptr || uv == nullptr || dst == nullptr || width < 2 || height < 2)
+    return false;
+
+  const ResizeTables &t = _getTables(width, height);
+
+  size_t planeSize = (size_t)m_dstWidth * m_dstHeight;
+  int round = 1 << (YUV_SHIFT - 1);
+
+  for (int dy = 0; dy < m_dstHeight; dy++)
+  {
+    size_t rowIdx = (size_t)dy * m_dstWidth;
+    int iy = dy - t.padTop;
+    if (iy < 0 || iy >= t.imgHeight)
+    {
+      for (int dx = 0; dx < m_dstWidth; dx++)
+        _storeRGB(dst, rowIdx + dx, planeSize, m_layout, pad, pad, pad);
+      continue;
+    }
+
+    const uint8_t *yRow0 = y + t.y0[iy] * yPitch;
+    const uint8_t *yRow1 = y + t.y1[iy] * yPitch;
+    const uint8_t *uvRow = uv + t.cy[iy] * uvPitch;
+    int wy = t.wy[iy];
+
+    for (int dx = 0; dx < m_dstWidth; dx++)
+    {
+      int ix = dx - t.padLeft;
+      if (ix < 0 || ix >= t.imgWidth)
+      {
+        _storeRGB(dst, rowIdx + dx, planeSize, m_layout, pad, pad, pad);
+        continue;
+      }
+
+      int x0 = t.x0[ix];
+      int x1 = t.x1[ix];
+
+      // Bilinear luma, chroma is already half resolution and taken nearest
+      int luma = _bilinear(yRow0[x0], yRow0[x1], yRow1[x0], yRow1[x1], t.wx[ix], wy);
+
+      int yy = std::max(0, luma - 16) * YUV_CY;
+      int u = (int)uvRow[t.cx[ix]] - 128;
+      int v = (int)uvRow[t.cx[ix] + 1] - 128;
+
+      int r = _clip((yy + YUV_CVR * v + round) >> YUV_SHIFT);
+      int g = _clip((yy + YUV_CUG * u + YUV_CVG * v + round) >> YUV_SHIFT);
+      int b = _clip((yy + YUV_CUB * u + round) >> YUV_SHIFT);
+
+      _storeRGB(dst, rowIdx + dx, planeSize, m_layout, lut[0][r], lut[1][g], lut[2][b]);
+    }
+  }
+
+  return true;
+}
+
+
+template <typename T>
+bool FusedPreprocessor::_runBGR(const cv::Mat &src, T *dst, const T (*lut)[256], T pad)
+{
+  if (src.empty() || src.type() != CV_8UC3 || src.cols < 2 || src.rows < 2 || dst == nullptr)
+    return false;
+
+  const ResizeTables &t = _getTables(src.cols, src.rows);
+
+  size_t planeSize = (size_t)m_dstWidth * m_dstHeight;
+
+  for (int dy = 0; dy < m_dstHeight; dy++)
+  {
+    size_t rowIdx = (size_t)dy * m_dstWidth;
+    int iy = dy - t.padTop;
+    if (iy < 0 || iy >= t.imgHeight)
+    {
+      for (int dx = 0; dx < m_dstWidth; dx++)
+        _storeRGB(dst, rowIdx + dx, planeSize, m_layout, pad, pad, pad);
+      continue;
+    }
+
+    const uint8_t *row0 = src.ptr<uint8_t>(t.y0[iy]);
+    const uint8_t *row1 = src.ptr<uint8_t>(t.y1[iy]);
+    int wy = t.wy[iy];
+
+    for (int dx = 0; dx < m_dstWidth; dx++)
+    {
+      int ix = dx - t.padLeft;
+      if (ix < 0 || ix >= t.imgWidth)
+      {
+        _storeRGB(dst, rowIdx + dx, planeSize, m_layout, pad, pad, pad);
+        continue;
+      }
+
+      const uint8_t *p00 = row0 + 3 * t.x0[ix];
+      const uint8_t *p01 = row0 + 3 * t.x1[ix];
+      const uint8_t *p10 = row1 + 3 * t.x0[ix];
+      const uint8_t *p11 = row1 + 3 * t.x1[ix];
+      int wx = t.wx[ix];
+
+      int b = _bilinear(p00[0], p01[0], p10[0], p11[0], wx, wy);
+      int g = _bilinear(p00[1], p01[1], p10[1], p11[1], wx, wy);
+      int r = _bilinear(p00[2], p01[2], p10[2], p11[2], wx, wy);
+
+      _storeRGB(dst, rowIdx + dx, planeSize, m_layout, lut[0][r], lut[1][g], lut[2][b]);
+    }
+  }
+
+  return true;
+}
+
+
+const FusedPreprocessor::ResizeTables &FusedPreprocessor::_getTables(int srcWidth, int srcHeight)
+{
+  size_t i = 0;
+  for (; i < m_tables.size(); i++)
+  {
+    const ResizeTables &t = m_tables[i];
+    if (t.srcWidth == srcWidth && t.srcHeight == srcHeight && t.letterbox == m_letterbox)
+      break;
+  }
+
+  if (i == m_tables.size())
+  {
+    if ((int)m_tables.size() >= m_maxTables)
+      m_tables.pop_back();
+    m_tables.insert(m_tables.begin(), ResizeTables());
+    _buildTables(m_tables[0], srcWidth, srcHeight);
+  }
+  else if (i > 0)
+  {
+    std::rotate(m_tables.begin(), m_tables.begin() + i, m_tables.begin() + i + 1);
+  }
+
+  m_transform = m_tables[0].transform;
+
+  return m_tables[0];
+}
+
+
+void FusedPreprocessor::_buildTables(ResizeTables &tables, int srcWidth, int srcHeight)
+{
+  tables.srcWidth = srcWidth;
+  tables.srcHeight = srcHeight;
+  tables.letterbox = m_letterbox;
+  tables.transform = LetterboxTransform::make(
+    cv::Size(srcWidth, srcHeight), cv::Size(m_dstWidth, m_dstHeight), m_letterbox);
+  tables.padLeft = (int)tables.transform.padX;
+  tables.padTop = (int)tables.transform.padY;
+  tables.imgWidth = (int)(srcWidth * tables.transform.scaleX + 0.5f);
+  tables.imgHeight = (int)(srcHeight * tables.transform.scaleY + 0.5f);
+
+  // Pixel centers are aligned like cv::resize does
+  float scaleX = (float)srcWidth / tables.imgWidth;
+  tables.x0.resize(tables.imgWidth);
+  tables.x1.resize(tables.imgWidth);
+  tables.wx.resize(tables.imgWidth);
+  tables.cx.resize(tables.imgWidth);
+  for (int ix = 0; ix < tables.imgWidth; ix++)
+  {
+    float sx = std::min(std::max((ix + 0.5f) * scaleX - 0.5f, 0.0f), (float)(srcWidth - 1));
+    tables.x0[ix] = (int)sx;
+    tables.x1[ix] = std::min(tables.x0[ix] + 1, srcWidth - 1);
+    tables.wx[ix] = (int)((sx - tables.x0[ix]) * RESIZE_COEF_ONE + 0.5f);
+    tables.cx[ix] = (std::min((int)(sx + 0.5f), srcWidth - 1) >> 1) * 2;
+  }
+
+  float scaleY = (float)srcHeight / tables.imgHeight;
+  tables.y0.resize(tables.imgHeight);
+  tables.y1.resize(tables.imgHeight);
+  tables.wy.resize(tables.imgHeight);
+  tables.cy.resize(tables.imgHeight);
+  for (int iy = 0; iy < tables.imgHeight; iy++)
+  {
+    float sy = std::min(std::max((iy + 0.5f) * scaleY - 0.5f, 0.0f), (float)(srcHeight - 1));
+    tables.y0[iy] = (int)sy;
+    tables.y1[iy] = std::min(tables.y0[iy] + 1, srcHeight - 1);
+    tables.wy[iy] = (int)((sy - tables.y0[iy]) * RESIZE_COEF_ONE + 0.5f);
+    tables.cy[iy] = std::min((int)(sy + 0.5f), srcHeight - 1) >> 1;
+  }
+}
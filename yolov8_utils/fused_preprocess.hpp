@@ -0,0 +1,158 @@
+#ifndef __FUSED_PREPROCESS__
+#define __FUSED_PREPROCESS__
+
+#include <stdint.h>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+
+enum PreprocLayout
+{
+  PREPROC_NHWC = 0,   // interleaved RGB
+  PREPROC_NCHW = 1    // planar RGB
+};
+
+
+// Mapping between source image and network input coordinates. A plain
+// resize has scaleX != scaleY and no padding, a letterbox keeps the aspect
+// ratio and centers the image between padding bars. When only a region of
+// the source is fed to the network, offsetX/Y is its top left corner.
+struct LetterboxTransform
+{
+  float scaleX = 1.0f;    // network pixels per source pixel
+  float scaleY = 1.0f;
+  float padX = 0.0f;      // left padding, network pixels
+  float padY = 0.0f;      // top padding, network pixels
+  float offsetX = 0.0f;   // source region origin, source pixels
+  float offsetY = 0.0f;
+
+  static LetterboxTransform make(cv::Size srcSize, cv::Size dstSize, bool letterbox);
+
+  // Source to network
+  float forwardX(float x) const { return (x - offsetX) * scaleX + padX; };
+  float forwardY(float y) const { return (y - offsetY) * scaleY + padY; };
+  cv::Point2f forward(const cv::Point2f &p) const;
+  cv::Rect2f forwardBox(const cv::Rect2f &box) const;
+
+  // Network to source
+  float inverseX(float x) const { return (x - padX) / scaleX + offsetX; };
+  float inverseY(float y) const { return (y - padY) / scaleY + offsetY; };
+  cv::Point2f inverse(const cv::Point2f &p) const;
+  cv::Rect2f inverseBox(const cv::Rect2f &box) const;
+};
+
+
+// Builds the network input from a camera frame in one pass: bilinear resize,
+// color conversion to RGB, an optional per channel enhancement curve and
+// normalization to [0, 1] per output pixel, so no full resolution BGR image
+// is made on the way.
+class FusedPreprocessor
+{
+ public:
+  FusedPreprocessor(int dstWidth, int dstHeight, PreprocLayout layout = PREPROC_NHWC);
+  ~FusedPreprocessor();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  // Keep the source aspect ratio and pad the borders with padValue
+  void setLetterbox(bool enable, uint8_t padValue = 114);
+  bool isLetterbox() { return m_letterbox; };
+
+  // Transform of the last processed frame
+  LetterboxTransform getTransform() { return m_transform; };
+
+  // Curve applied to the pixel values before normalization, a 1x256 CV_8UC3
+  // table in BGR order as for cv::LUT. An empty Mat disables it.
+  void setEnhancementLUT(const cv::Mat &lut);
+
+  // NV12 frame with pitched Y and interleaved UV planes
+  bool runNV12(
+    const uint8_t *y,
+    size_t yPitch,
+    const uint8_t *uv,
+    size_t uvPitch,
+    int width,
+    int height,
+    float *dst);
+
+  // Same, but writes the 8-bit RGB values for a network whose input
+  // quantization already holds the 1/255 scale
+  bool runNV12(
+    const uint8_t *y,
+    size_t yPitch,
+    const uint8_t *uv,
+    size_t uvPitch,
+    int width,
+    int height,
+    uint8_t *dst);
+
+  // 8-bit BGR image
+  bool runBGR(const cv::Mat &src, float *dst);
+  bool runBGR(const cv::Mat &src, uint8_t *dst);
+
+ private:
+  // Sampling tables of one source size, only the image area (without the
+  // letterbox padding) is covered
+  struct ResizeTables
+  {
+    int srcWidth = 0;
+    int srcHeight = 0;
+    bool letterbox = false;
+    LetterboxTransform transform;
+    int padLeft = 0;
+    int padTop = 0;
+    int imgWidth = 0;
+    int imgHeight = 0;
+    vector<int> x0;        // left source column of each output column
+    vector<int> x1;        // right source column
+    vector<int> wx;        // weight of the right column, fixed point
+    vector<int> y0;
+    vector<int> y1;
+    vector<int> wy;
+    vector<int> cx;        // UV byte offset of each output column (nearest)
+    vector<int> cy;        // UV row of each output row (nearest)
+  };
+
+  template <typename T>
+  bool _runNV12(
+    const uint8_t *y,
+    size_t yPitch,
+    const uint8_t *uv,
+    size_t uvPitch,
+    int width,
+    int height,
+    T *dst,
+    const T (*lut)[256],
+    T pad);
+
+  template <typename T>
+  bool _runBGR(const cv::Mat &src, T *dst, const T (*lut)[256], T pad);
+
+  const ResizeTables &_getTables(int srcWidth, int srcHeight);
+  void _buildTables(ResizeTables &tables, int srcWidth, int srcHeight);
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  int m_dstWidth = 0;
+  int m_dstHeight = 0;
+  PreprocLayout m_layout = PREPROC_NHWC;
+  bool m_letterbox = false;
+  uint8_t m_padValue = 114;
+
+  // Tables per source size, most recently used first
+  vector<ResizeTables> m_tables;
+  int m_maxTables = 8;
+  LetterboxTransform m_transform;
+
+  // Pixel value to network input, per R, G, B channel
+  float m_normLUT[3][256];
+  uint8_t m_u8LUT[3][256];
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "half_float.hpp"
+
+
+float halfKernel::toFloat(uint16_t h)
+{
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  uint32_t bits;
+
+  if (exp == 0x1f)
+  {
+    // Inf, NaN
+    bits = sign | 0x7f800000 | (mant << 13);
+  }
+  else if (exp != 0)
+  {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+  else if (mant == 0)
+  {
+    bits = sign;
+  }
+  else
+  {
+    // Subnormal, normalize it
+    exp = 113;
+    while (!(mant & 0x400))
+    {
+      mant <<= 1;
+      exp--;
+    }
+    bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+  }
+
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+
+uint16_t halfKernel::fromFloat(float f)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+
+  uint16_t sign = (bits >> 16) & 0x8000;
+  uint32_t absBits = bits & 0x7fffffff;
+
+  // Inf, NaN
+  if (absBits >= 0x7f800000)
+    return sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0);
+
+  // Rounds past the largest half (65504)
+  if (absBits >= 0x477ff000)
+    return sign | 0x7c00;
+
+  // Subnormal halves, round to nearest even
+  if (absBits < 0x38800000)
+  {
+    if (absBits < 0x33000000)
+      return sign;
+
+    uint32_t exp = absBits >> 23;
+    uint32_t mant = (absBits & 0x7fffff) | 0x800000;
+    uint32_t shift = 126 - exp;
+    uint32_t h = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1)))
+      h++;
+
+    return sign | (uint16_t)h;
+  }
+
+  // Normal halves: rebias the exponent, round the dropped 13 bits to
+  // nearest even. A carry into the exponent is still correct.
+  uint32_t h = (absBits - 0x38000000) >> 13;
+  uint32_t rem = absBits & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+    h++;
+
+  return sign | (uint16_t)h;
+}
+
+
+void halfKernel::toFloat(const uint16_t *src, float *dst, size_t n)
+{
+  size_t i = 0;
+
+#if defined(__F16C__)
+  for (; i + 8 <= n; i += 8)
+  {
+    __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    float16x4_t h = vreinterpret_f16_u16(vld1_u16(src + i));
+    vst1q_f32(dst + i, vcvt_f32_f16(h));
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    dst[i] = toFloat(src[i]);
+  }
+}
+
+
+void halfKernel::fromFloat(const float *src, uint16_t *dst, size_t n)
+{
+  size_t i = 0;
+
+#if defined(__F16C__)
+  for (; i + 8 <= n; i += 8)
+  {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i *)(dst + i), h);
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  for (; i + 4 <= n; i += 4)
+  {
+    float16x4_t h = vcvt_f16_f32(vld1q_f32(src + i));
+    vst1_u16(dst + i, vreinterpret_u16_f16(h));
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    dst[i] = fromFloat(src[i]);
+  }
+}
+
+
+uint16_t halfKernel::thresholdFromFloat(float threshold)
+{
+  if (!(threshold > 0.0f))
+    return 0;
+
+  uint16_t h = fromFloat(threshold);
+  if (h < 0x7c00 && toFloat(h) < threshold)
+    h++;
+
+  return h;
+}
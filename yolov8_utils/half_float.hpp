@@ -0,0 +1,32 @@
+#ifndef __HALF_FLOAT__
+#define __HALF_FLOAT__
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+
+// IEEE 754 half precision values stored as uint16_t. The array conversions
+// use F16C on x86 and NEON on aarch64 when the compiler enables them.
+namespace halfKernel
+{
+  float toFloat(uint16_t h);
+  uint16_t fromFloat(float f);
+
+  void toFloat(const uint16_t *src, float *dst, size_t n);
+  void fromFloat(const float *src, uint16_t *dst, size_t n);
+
+  // Non-negative halves order like their bit patterns, so a threshold can be
+  // compared without converting. Negative values (sign bit set) are below
+  // any non-negative threshold.
+  inline bool isAtLeast(uint16_t h, uint16_t threshold)
+  {
+    return !(h & 0x8000) && h >= threshold;
+  }
+
+  // Smallest non-negative half >= threshold (threshold >= 0)
+  uint16_t thresholdFromFloat(float threshold);
+}
+
+#endif
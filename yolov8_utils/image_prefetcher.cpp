@@ -0,0 +1,189 @@
+#include "image_prefetcher.hpp"
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+ImagePrefetcher::ImagePrefetcher(
+  const vector<string> &fileList,
+  int numWorkers,
+  int lookAhead,
+  cv::Size resizeTo)
+{
+  m_fileList = fileList;
+  m_resizeTo = resizeTo;
+  m_lookAhead = std::max(lookAhead, 1);
+
+  numWorkers = std::max(numWorkers, 1);
+  for (int i = 0; i < numWorkers; i++)
+  {
+    m_workers.push_back(std::thread(&ImagePrefetcher::_worker, this));
+  }
+};
+
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+  stop();
+};
+
+
+void ImagePrefetcher::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+
+  for (size_t i = 0; i < m_workers.size(); i++)
+  {
+    if (m_workers[i].joinable())
+      m_workers[i].join();
+  }
+  m_workers.clear();
+}
+
+
+bool ImagePrefetcher::pop(const string &filePath, cv::Mat &img)
+{
+  auto time_0 = std::chrono::high_resolution_clock::now();
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  cv::Size resizeTo = m_resizeTo;
+
+  size_t idx = m_nextConsume;
+  while (idx < m_fileList.size() && m_fileList[idx] != filePath)
+    idx++;
+
+  // Not in the rest of the list, the look-ahead can't help here
+  if (idx == m_fileList.size())
+  {
+    lock.unlock();
+    return _decode(filePath, resizeTo, img);
+  }
+
+  // Files were skipped, drop what was decoded for them and move the window
+  // past them, else the workers wait on a file that is never popped
+  if (idx > m_nextConsume)
+  {
+    m_ready.erase(m_ready.begin(), m_ready.lower_bound(idx));
+    m_nextConsume = idx;
+    m_nextSubmit = std::max(m_nextSubmit, idx);
+    m_cond.notify_all();
+  }
+
+  m_cond.wait(lock, [&] { return m_ready.count(idx) > 0 || m_stop; });
+  if (m_ready.count(idx) == 0)
+    return false;
+
+  bool stale = m_ready[idx].second != resizeTo;
+  img = m_ready[idx].first;
+  m_ready.erase(idx);
+  m_nextConsume++;
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_waitMs += std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000);
+  if (m_popped)
+  {
+    // Time between two pops minus the wait is what the caller spent on inference
+    m_busyMs += std::chrono::duration_cast<std::chrono::nanoseconds>(time_0 - m_lastPop).count() / (1000.0 * 1000);
+  }
+  m_lastPop = time_1;
+  m_popped = true;
+  m_count++;
+  lock.unlock();
+
+  m_cond.notify_all();
+
+  // Decoded before the resize size changed
+  if (stale)
+    return _decode(filePath, resizeTo, img);
+
+  return !img.empty();
+}
+
+
+void ImagePrefetcher::setResizeTo(cv::Size resizeTo)
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_resizeTo = resizeTo;
+}
+
+
+void ImagePrefetcher::getStats(float &decodeMs, float &waitMs, float &busyMs, int &count)
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+
+  count = m_count;
+  decodeMs = m_count > 0 ? m_decodeMs / m_count : 0;
+  waitMs = m_count > 0 ? m_waitMs / m_count : 0;
+  busyMs = m_count > 1 ? m_busyMs / (m_count - 1) : 0;
+}
+
+
+void ImagePrefetcher::resetStats()
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+
+  m_decodeMs = 0;
+  m_waitMs = 0;
+  m_busyMs = 0;
+  m_count = 0;
+  m_popped = false;
+}
+
+
+/////////////////////////
+// private member functions
+////////////////////////
+void ImagePrefetcher::_worker()
+{
+  while (true)
+  {
+    size_t idx;
+    cv::Size resizeTo;
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_cond.wait(lock, [&] {
+        return m_stop || (m_nextSubmit < m_fileList.size() &&
+          m_nextSubmit < m_nextConsume + m_lookAhead);
+      });
+      if (m_stop)
+        break;
+      idx = m_nextSubmit++;
+      resizeTo = m_resizeTo;
+    }
+
+    cv::Mat img;
+    auto time_0 = std::chrono::high_resolution_clock::now();
+    _decode(m_fileList[idx], resizeTo, img);
+    auto time_1 = std::chrono::high_resolution_clock::now();
+
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      // Skipped while it was decoded
+      if (idx >= m_nextConsume)
+        m_ready[idx] = std::make_pair(img, resizeTo);
+      m_decodeMs += std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000);
+    }
+    m_cond.notify_all();
+  }
+}
+
+
+bool ImagePrefetcher::_decode(const string &filePath, cv::Size resizeTo, cv::Mat &img)
+{
+  img = cv::imread(filePath, -1);
+  if (img.empty())
+    return false;
+
+  if (resizeTo.area() > 0 && img.size() != resizeTo)
+  {
+    cv::Mat imgResized;
+    cv::resize(img, imgResized, resizeTo, cv::INTER_LINEAR);
+    img = imgResized;
+  }
+
+  return true;
+}
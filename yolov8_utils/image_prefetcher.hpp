@@ -0,0 +1,80 @@
+#ifndef __IMAGE_PREFETCHER__
+#define __IMAGE_PREFETCHER__
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+
+
+// Decodes the next files of a known list on a worker pool while the
+// current one is in inference. Files are handed out in list order, a file
+// further down the list skips the ones before it.
+class ImagePrefetcher
+{
+ public:
+  ImagePrefetcher(
+    const vector<string> &fileList,
+    int numWorkers,
+    int lookAhead,
+    cv::Size resizeTo = cv::Size());
+  ~ImagePrefetcher();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  bool pop(const string &filePath, cv::Mat &img);
+  void stop();
+
+  // Size the next images are resized to, empty for none. Images decoded
+  // ahead for another size are decoded again when popped.
+  void setResizeTo(cv::Size resizeTo);
+
+  // Statistics since the last reset, per image in ms
+  void getStats(float &decodeMs, float &waitMs, float &busyMs, int &count);
+  void resetStats();
+
+ private:
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  void _worker();
+  bool _decode(const string &filePath, cv::Size resizeTo, cv::Mat &img);
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  vector<string> m_fileList;
+  vector<std::thread> m_workers;
+  cv::Size m_resizeTo;
+  int m_lookAhead = 1;
+
+  std::mutex m_lock;
+  std::condition_variable m_cond;
+  // Decoded images and the size they were resized to
+  std::map<size_t, std::pair<cv::Mat, cv::Size>> m_ready;
+  size_t m_nextSubmit = 0;
+  size_t m_nextConsume = 0;
+  bool m_stop = false;
+
+  // Statistics
+  double m_decodeMs = 0;
+  double m_waitMs = 0;
+  double m_busyMs = 0;
+  int m_count = 0;
+  bool m_popped = false;
+  std::chrono::high_resolution_clock::time_point m_lastPop;
+};
+
+#endif
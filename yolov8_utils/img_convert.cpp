@@ -0,0 +1,421 @@
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+// OpenCV
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "img_convert.hpp"
+
+
+namespace imgConvert
+{
+
+/////////////////////////
+// kernels
+////////////////////////
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static int _interleaveRowSIMD(
+  const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, int width)
+{
+  int x = 0;
+  for (; x + 16 <= width; x += 16)
+  {
+    uint8x16x3_t px;
+    px.val[0] = vld1q_u8(c0 + x);
+    px.val[1] = vld1q_u8(c1 + x);
+    px.val[2] = vld1q_u8(c2 + x);
+    vst3q_u8(dst + 3 * x, px);
+  }
+  return x;
+}
+#elif defined(__SSSE3__) || defined(__AVX2__)
+// Output byte k of block j comes from pixel (16j + k) / 3 of plane (16j + k) % 3
+static const int8_t s_shuffle[3][3][16] = {
+  {{0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5},
+   {-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1},
+   {-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1}},
+  {{-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1},
+   {5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10},
+   {-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1}},
+  {{-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+   {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+   {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15}}};
+
+static int _interleaveRowSIMD(
+  const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, int width)
+{
+  __m128i mask[3][3];
+  for (int j = 0; j < 3; j++)
+  {
+    for (int p = 0; p < 3; p++)
+      mask[j][p] = _mm_loadu_si128((const __m128i *)s_shuffle[j][p]);
+  }
+
+  int x = 0;
+#if defined(__AVX2__)
+  // Same shuffles on both 128-bit lanes, lane 0 makes the 48 bytes of pixels
+  // x..x+15 and lane 1 those of x+16..x+31, then the lanes are reordered.
+  __m256i mask256[3][3];
+  for (int j = 0; j < 3; j++)
+  {
+    for (int p = 0; p < 3; p++)
+      mask256[j][p] = _mm256_broadcastsi128_si256(mask[j][p]);
+  }
+
+  for (; x + 32 <= width; x += 32)
+  {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(c0 + x));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(c1 + x));
+    __m256i c = _mm256_loadu_si256((const __m256i *)(c2 + x));
+    __m256i out[3];
+    for (int j = 0; j < 3; j++)
+    {
+      out[j] = _mm256_or_si256(
+        _mm256_or_si256(_mm256_shuffle_epi8(a, mask256[j][0]), _mm256_shuffle_epi8(b, mask256[j][1])),
+        _mm256_shuffle_epi8(c, mask256[j][2]));
+    }
+    _mm256_storeu_si256((__m256i *)(dst + 3 * x), _mm256_permute2x128_si256(out[0], out[1], 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 3 * x + 32), _mm256_permute2x128_si256(out[2], out[0], 0x30));
+    _mm256_storeu_si256((__m256i *)(dst + 3 * x + 64), _mm256_permute2x128_si256(out[1], out[2], 0x31));
+  }
+#endif
+  for (; x + 16 <= width; x += 16)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i *)(c0 + x));
+    __m128i b = _mm_loadu_si128((const __m128i *)(c1 + x));
+    __m128i c = _mm_loadu_si128((const __m128i *)(c2 + x));
+    for (int j = 0; j < 3; j++)
+    {
+      __m128i out = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(a, mask[j][0]), _mm_shuffle_epi8(b, mask[j][1])),
+        _mm_shuffle_epi8(c, mask[j][2]));
+      _mm_storeu_si128((__m128i *)(dst + 3 * x + 16 * j), out);
+    }
+  }
+  return x;
+}
+#else
+static int _interleaveRowSIMD(
+  const uint8_t *c0, const uint8_t *c1, const uint8_t *c2, uint8_t *dst, int width)
+{
+  return 0;
+}
+#endif
+
+
+void planarToInterleaved(
+  const uint8_t *c0,
+  const uint8_t *c1,
+  const uint8_t *c2,
+  size_t srcPitch,
+  uint8_t *dst,
+  size_t dstPitch,
+  int width,
+  int height)
+{
+  for (int y = 0; y < height; y++)
+  {
+    int x = _interleaveRowSIMD(c0, c1, c2, dst, width);
+    for (; x < width; x++)
+    {
+      dst[3 * x] = c0[x];
+      dst[3 * x + 1] = c1[x];
+      dst[3 * x + 2] = c2[x];
+    }
+    c0 += srcPitch;
+    c1 += srcPitch;
+    c2 += srcPitch;
+    dst += dstPitch;
+  }
+}
+
+
+void rgbPlanarToBgr(
+  const uint8_t *data,
+  size_t pitch,
+  int width,
+  int height,
+  uint8_t *dst,
+  size_t dstPitch)
+{
+  size_t planeSize = pitch * height;
+
+  planarToInterleaved(
+    data + 2 * planeSize, data + planeSize, data, pitch, dst, dstPitch, width, height);
+}
+
+
+void copyPlane(
+  const uint8_t *src,
+  size_t srcPitch,
+  uint8_t *dst,
+  size_t dstPitch,
+  int width,
+  int height)
+{
+  if (srcPitch == (size_t)width && dstPitch == (size_t)width)
+  {
+    memcpy(dst, src, (size_t)width * height);
+    return;
+  }
+
+  for (int y = 0; y < height; y++)
+  {
+    memcpy(dst, src, width);
+    src += srcPitch;
+    dst += dstPitch;
+  }
+}
+
+
+/////////////////////////
+// cv::Mat wrappers
+////////////////////////
+bool planarToMat(
+  const uint8_t *data,
+  size_t pitch,
+  int width,
+  int height,
+  int channels,
+  cv::Mat &dst,
+  bool swapRB)
+{
+  if (data == nullptr || (channels != 1 && channels != 3))
+    return false;
+
+  size_t planeSize = pitch * height;
+  if (channels == 1)
+  {
+    dst.create(height, width, CV_8UC1);
+    copyPlane(data, pitch, dst.data, dst.step[0], width, height);
+  }
+  else if (swapRB)
+  {
+    dst.create(height, width, CV_8UC3);
+    rgbPlanarToBgr(data, pitch, width, height, dst.data, dst.step[0]);
+  }
+  else
+  {
+    dst.create(height, width, CV_8UC3);
+    planarToInterleaved(
+      data, data + planeSize, data + 2 * planeSize, pitch, dst.data, dst.step[0], width, height);
+  }
+
+  return true;
+}
+
+
+bool planarViews(
+  uint8_t *data,
+  size_t pitch,
+  int width,
+  int height,
+  int channels,
+  vector<cv::Mat> &planes)
+{
+  if (data == nullptr || channels <= 0)
+    return false;
+
+  planes.resize(channels);
+  for (int i = 0; i < channels; i++)
+  {
+    planes[i] = cv::Mat(height, width, CV_8UC1, data + i * pitch * height, pitch);
+  }
+
+  return true;
+}
+
+
+void benchmarkPlanarToInterleaved(int width, int height, int loops)
+{
+  // Pitch as the EA tensors have it, rows aligned to 32 bytes
+  size_t pitch = (width + 31) / 32 * 32;
+  vector<uint8_t> planar(pitch * height * 3);
+  for (size_t i = 0; i < planar.size(); i++)
+    planar[i] = (uint8_t)(i * 31);
+
+  vector<cv::Mat> planes;
+  planarViews(&planar[0], pitch, width, height, 3, planes);
+  std::swap(planes[0], planes[2]);
+
+  cv::Mat merged;
+  cv::Mat converted(height, width, CV_8UC3);
+  double mergeMs = 0;
+  double convertMs = 0;
+  loops = loops > 0 ? loops : 1;
+
+  for (int i = 0; i < loops; i++)
+  {
+    int64 tick_0 = cv::getTickCount();
+    cv::merge(planes, merged);
+    int64 tick_1 = cv::getTickCount();
+    rgbPlanarToBgr(&planar[0], pitch, width, height, converted.data, converted.step[0]);
+    int64 tick_2 = cv::getTickCount();
+
+    mergeMs += (tick_1 - tick_0) * 1000.0 / cv::getTickFrequency();
+    convertMs += (tick_2 - tick_1) * 1000.0 / cv::getTickFrequency();
+  }
+
+  bool same = cv::countNonZero(merged.reshape(1) != converted.reshape(1)) == 0;
+  cout << "[imgConvert] " << width << "x" << height << " rgb planar to bgr: "
+       << "cv::merge " << mergeMs / loops << " ms, "
+       << "rgbPlanarToBgr " << convertMs / loops << " ms"
+       << (same ? "" : " (output MISMATCH)") << endl;
+}
+
+
+/////////////////////////
+// Nv12Converter
+////////////////////////
+static inline uint8_t _clip(int v)
+{
+  return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+
+bool Nv12Converter::convert(
+  const uint8_t *y,
+  size_t yPitch,
+  const uint8_t *uv,
+  size_t uvPitch,
+  int width,
+  int height,
+  cv::Mat &dst,
+  cv::Size dstSize)
+{
+  if (y == nullptr || uv == nullptr || width <= 0 || height <= 0)
+    return false;
+
+  if (dstSize.area() <= 0)
+    dstSize = cv::Size(width, height);
+  dst.create(dstSize, CV_8UC3);
+
+  // Full size goes to OpenCV's vectorized kernel, on headers over the planes
+  if (dstSize.width == width && dstSize.height == height)
+  {
+#if CV_VERSION_MAJOR >= 4
+    cv::Mat yPlane(height, width, CV_8UC1, (void *)y, yPitch);
+    cv::Mat uvPlane(height / 2, width / 2, CV_8UC2, (void *)uv, uvPitch);
+    cv::cvtColorTwoPlane(yPlane, uvPlane, dst, cv::COLOR_YUV2BGR_NV12);
+#else
+    // OpenCV 3 only takes NV12 as one buffer: a header over the planes when
+    // UV follows Y with the same pitch, otherwise they are packed into a
+    // buffer kept between calls
+    if (uv == y + height * yPitch && uvPitch == yPitch)
+    {
+      cv::Mat nv12(height * 3 / 2, width, CV_8UC1, (void *)y, yPitch);
+      cv::cvtColor(nv12, dst, CV_YUV2BGR_NV12);
+      return true;
+    }
+
+    m_packed.create(height * 3 / 2, width, CV_8UC1);
+    for (int row = 0; row < height; row++)
+    {
+      memcpy(m_packed.ptr(row), y + row * yPitch, width);
+    }
+    for (int row = 0; row < height / 2; row++)
+    {
+      memcpy(m_packed.ptr(height + row), uv + row * uvPitch, width);
+    }
+    cv::cvtColor(m_packed, dst, CV_YUV2BGR_NV12);
+#endif
+    return true;
+  }
+
+  if (width != m_width || height != m_height || dstSize != m_dstSize)
+    _buildTables(width, height, dstSize);
+
+  for (int dy = 0; dy < dstSize.height; dy++)
+  {
+    int sy = m_yTable[dy];
+    const uint8_t *yRow = y + sy * yPitch;
+    const uint8_t *uvRow = uv + (sy >> 1) * uvPitch;
+    uint8_t *out = dst.ptr(dy);
+
+    for (int dx = 0; dx < dstSize.width; dx++)
+    {
+      int sx = m_xTable[dx];
+      int yy = std::max(0, (int)yRow[sx] - 16) * YUV_CY;
+      int u = (int)uvRow[sx & ~1] - 128;
+      int v = (int)uvRow[sx | 1] - 128;
+      int round = 1 << (YUV_SHIFT - 1);
+
+      out[3 * dx] = _clip((yy + YUV_CUB * u + round) >> YUV_SHIFT);
+      out[3 * dx + 1] = _clip((yy + YUV_CUG * u + YUV_CVG * v + round) >> YUV_SHIFT);
+      out[3 * dx + 2] = _clip((yy + YUV_CVR * v + round) >> YUV_SHIFT);
+    }
+  }
+
+  return true;
+}
+
+
+void Nv12Converter::_buildTables(int width, int height, cv::Size dstSize)
+{
+  m_width = width;
+  m_height = height;
+  m_dstSize = dstSize;
+
+  // Source sample nearest to the center of each output pixel
+  m_xTable.resize(dstSize.width);
+  for (int dx = 0; dx < dstSize.width; dx++)
+    m_xTable[dx] = std::min(width - 1, (int)(((2 * (int64_t)dx + 1) * width) / (2 * dstSize.width)));
+
+  m_yTable.resize(dstSize.height);
+  for (int dy = 0; dy < dstSize.height; dy++)
+    m_yTable[dy] = std::min(height - 1, (int)(((2 * (int64_t)dy + 1) * height) / (2 * dstSize.height)));
+}
+
+
+/////////////////////////
+// MatPool
+////////////////////////
+MatPool::MatPool(int maxSize)
+{
+  m_maxSize = maxSize;
+}
+
+
+cv::Mat MatPool::acquire(int rows, int cols, int type)
+{
+  int reusable = -1;
+
+  for (size_t i = 0; i < m_pool.size(); i++)
+  {
+    // Only the pool holds it
+    if (m_pool[i].u == nullptr || CV_XADD(&m_pool[i].u->refcount, 0) != 1)
+      continue;
+
+    if (m_pool[i].rows == rows && m_pool[i].cols == cols && m_pool[i].type() == type)
+      return m_pool[i];
+
+    reusable = i;
+  }
+
+  if ((int)m_pool.size() < m_maxSize)
+  {
+    m_pool.push_back(cv::Mat(rows, cols, type));
+    return m_pool.back();
+  }
+
+  // Pool is full, shape changed: recycle a free slot
+  if (reusable >= 0)
+  {
+    m_pool[reusable].create(rows, cols, type);
+    return m_pool[reusable];
+  }
+
+  // Every buffer is still held by the caller
+  return cv::Mat(rows, cols, type);
+}
+
+}
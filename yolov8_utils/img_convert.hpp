@@ -0,0 +1,121 @@
+#ifndef __IMG_CONVERT__
+#define __IMG_CONVERT__
+
+#include <stdint.h>
+#include <vector>
+
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+using namespace std;
+
+
+// BT.601 video range, same fixed point coefficients as OpenCV's NV12 path
+#define YUV_SHIFT 20
+#define YUV_CY 1220542
+#define YUV_CUB 2116026
+#define YUV_CUG (-409993)
+#define YUV_CVG (-852492)
+#define YUV_CVR 1673527
+
+
+namespace imgConvert
+{
+  // Three 8-bit planes of width x height (srcPitch bytes per row) to one
+  // interleaved 3-channel image (dstPitch bytes per row).
+  void planarToInterleaved(
+    const uint8_t *c0,
+    const uint8_t *c1,
+    const uint8_t *c2,
+    size_t srcPitch,
+    uint8_t *dst,
+    size_t dstPitch,
+    int width,
+    int height);
+
+  // Planar RGB (as in an EA tensor) to interleaved BGR in a caller buffer,
+  // the channel swap is folded into the interleave.
+  void rgbPlanarToBgr(
+    const uint8_t *data,
+    size_t pitch,
+    int width,
+    int height,
+    uint8_t *dst,
+    size_t dstPitch);
+
+  void copyPlane(
+    const uint8_t *src,
+    size_t srcPitch,
+    uint8_t *dst,
+    size_t dstPitch,
+    int width,
+    int height);
+
+  // Planar image with `channels` planes of height rows each, as laid out in
+  // an EA tensor. dst is only (re)allocated when its shape doesn't match.
+  bool planarToMat(
+    const uint8_t *data,
+    size_t pitch,
+    int width,
+    int height,
+    int channels,
+    cv::Mat &dst,
+    bool swapRB = false);
+
+  // Mat headers on the planes, no copy. Valid as long as data is.
+  bool planarViews(
+    uint8_t *data,
+    size_t pitch,
+    int width,
+    int height,
+    int channels,
+    vector<cv::Mat> &planes);
+
+
+  // Prints the planar to interleaved time against cv::merge
+  void benchmarkPlanarToInterleaved(int width, int height, int loops);
+
+  // NV12 to BGR straight from the pitched Y and interleaved UV planes, no
+  // repack. A dstSize other than the image size resamples in the same pass
+  // (nearest sample, meant for previews and snapshots). Tables are kept
+  // between calls, dst is only reallocated when its shape changes.
+  class Nv12Converter
+  {
+   public:
+    bool convert(
+      const uint8_t *y,
+      size_t yPitch,
+      const uint8_t *uv,
+      size_t uvPitch,
+      int width,
+      int height,
+      cv::Mat &dst,
+      cv::Size dstSize = cv::Size());
+
+   private:
+    void _buildTables(int width, int height, cv::Size dstSize);
+
+    int m_width = 0;
+    int m_height = 0;
+    cv::Size m_dstSize;
+    vector<int> m_xTable;    // Y column of each output column
+    vector<int> m_yTable;    // Y row of each output row
+    cv::Mat m_packed;        // NV12 repacked for OpenCV 3, see convert
+  };
+
+  // Frame buffers handed out to callers which may keep them for a while:
+  // a buffer is reused once the caller dropped its last reference.
+  class MatPool
+  {
+   public:
+    MatPool(int maxSize = 4);
+
+    cv::Mat acquire(int rows, int cols, int type);
+
+   private:
+    vector<cv::Mat> m_pool;
+    int m_maxSize;
+  };
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include <cstdio>
+
+#include "model_shape.hpp"
+
+
+static inline uint8_t _toMask(float v)
+{
+  // Same as convertTo(CV_8UC1) for class ids
+  return v <= 0.0f ? 0 : (v >= 255.0f ? 255 : (uint8_t)(v + 0.5f));
+}
+
+
+/////////////////////////
+// ModelShape
+////////////////////////
+int ModelShape::anchorCount(int inputWidth, int inputHeight)
+{
+  int count = 0;
+  for (int stride = 8; stride <= 32; stride *= 2)
+  {
+    count += (inputWidth / stride) * (inputHeight / stride);
+  }
+
+  return count;
+}
+
+
+string ModelShape::toString() const
+{
+  char classes[32];
+  if (numClasses > 0)
+    snprintf(classes, sizeof(classes), "%d classes", numClasses);
+  else
+    snprintf(classes, sizeof(classes), "class ids as emitted");
+
+  char buff[192];
+  snprintf(buff, sizeof(buff), "input %dx%dx%d, seg %dx%d, anchors %d x %d, %s, %s head",
+    inputHeight, inputWidth, inputChannel, segHeight, segWidth, numAnchors, boxDim, classes,
+    rawHead ? (rawChannelMajor ? "raw channel major" : "raw") : "decoded");
+
+  return string(buff);
+}
+
+
+/////////////////////////
+// Kernels
+////////////////////////
+void modelKernel::segToMask(const float *src, uint8_t *dst, int width, int height)
+{
+  int size = width * height;
+  for (int i = 0; i < size; i++)
+  {
+    dst[i] = _toMask(src[i]);
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef __MODEL_SHAPE__
+#define __MODEL_SHAPE__
+
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+
+// Tensor sizes of a loaded YOLO-ADAS model, filled from the model itself so
+// that one binary runs any of the exported input sizes.
+struct ModelShape
+{
+  int inputWidth = 0;
+  int inputHeight = 0;
+  int inputChannel = 0;
+  int segWidth = 0;         // lane / line maps, 1/8 of the input
+  int segHeight = 0;
+  int numAnchors = 0;       // detection candidates over the stride 8, 16, 32 grids
+  int boxDim = 0;           // values per candidate in det_box (raw head: DFL logits)
+  bool boxAnchorMajor = true;  // det_box as [anchors, boxDim]
+  int numClasses = 0;       // 0 when the outputs don't tell (decoded head)
+  bool rawHead = false;     // raw YOLOv8 head, see RawHeadDecoder
+  bool rawChannelMajor = false;  // raw head as [1, channels, anchors]
+
+  // Candidates of a YOLOv8 head for an input size
+  static int anchorCount(int inputWidth, int inputHeight);
+
+  int segSize() const { return segWidth * segHeight; };
+  string toString() const;
+};
+
+
+namespace modelKernel
+{
+  // Class map of the segmentation head (class ids as float) to an 8-bit mask
+  void segToMask(const float *src, uint8_t *dst, int width, int height);
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+
+#include "quantized_output.hpp"
+#include "half_float.hpp"
+
+
+/////////////////////////
+// QuantParams
+////////////////////////
+int QuantParams::quantizeThreshold(float threshold) const
+{
+  if (step <= 0.0f)
+    return 0;
+
+  int q = (int)std::ceil(threshold / step + zeroPoint);
+  q = std::max(0, std::min(q, 256));
+
+  // Float rounding can land one step off the boundary
+  while (q > 0 && (q - 1 - zeroPoint) * step >= threshold)
+    q--;
+  while (q < 256 && (q - zeroPoint) * step < threshold)
+    q++;
+
+  return q;
+}
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+QuantizedDetectionFilter::QuantizedDetectionFilter()
+{
+};
+
+
+QuantizedDetectionFilter::~QuantizedDetectionFilter()
+{
+};
+
+
+void QuantizedDetectionFilter::setParams(
+  const QuantParams &box,
+  const QuantParams &conf,
+  const QuantParams &cls,
+  int numAnchors,
+  int boxDim,
+  bool boxAnchorMajor)
+{
+  m_box = box;
+  m_conf = conf;
+  m_cls = cls;
+  m_numAnchors = numAnchors;
+  m_boxDim = boxDim;
+  m_boxAnchorMajor = boxAnchorMajor;
+  m_confThreshold = -1.0f;
+  m_halfThreshold = -1.0f;
+}
+
+
+int QuantizedDetectionFilter::run(
+  const uint8_t *box,
+  const uint8_t *conf,
+  const uint8_t *cls,
+  float confThreshold,
+  float *boxOut,
+  float *confOut,
+  float *clsOut)
+{
+  if (confThreshold != m_confThreshold)
+  {
+    m_confThresholdQ = m_conf.quantizeThreshold(confThreshold);
+    m_confThreshold = confThreshold;
+  }
+
+  // Element (anchor, k) of det_box
+  size_t anchorStride = m_boxAnchorMajor ? m_boxDim : 1;
+  size_t valueStride = m_boxAnchorMajor ? 1 : m_numAnchors;
+
+  // All zero first, the scan below then only reads until an anchor passes
+  std::fill(confOut, confOut + m_numAnchors, 0.0f);
+
+  int numPassed = 0;
+  for (int a = 0; a < m_numAnchors; a++)
+  {
+    if (conf[a] < m_confThresholdQ)
+      continue;
+
+    confOut[a] = m_conf.dequantize(conf[a]);
+    // Class ids are integers, the quantization grid rarely lands on them
+    clsOut[a] = std::round(m_cls.dequantize(cls[a]));
+    for (int k = 0; k < m_boxDim; k++)
+    {
+      size_t idx = a * anchorStride + k * valueStride;
+      boxOut[idx] = m_box.dequantize(box[idx]);
+    }
+    numPassed++;
+  }
+
+  return numPassed;
+}
+
+
+int QuantizedDetectionFilter::runHalf(
+  const uint16_t *box,
+  const uint16_t *conf,
+  const uint16_t *cls,
+  float confThreshold,
+  float *boxOut,
+  float *confOut,
+  float *clsOut)
+{
+  if (confThreshold != m_halfThreshold)
+  {
+    m_confThresholdH = halfKernel::thresholdFromFloat(confThreshold);
+    m_halfThreshold = confThreshold;
+  }
+
+  size_t anchorStride = m_boxAnchorMajor ? m_boxDim : 1;
+  size_t valueStride = m_boxAnchorMajor ? 1 : m_numAnchors;
+
+  // All zero first, the scan below then only reads until an anchor passes
+  std::fill(confOut, confOut + m_numAnchors, 0.0f);
+
+  int numPassed = 0;
+  for (int a = 0; a < m_numAnchors; a++)
+  {
+    if (!halfKernel::isAtLeast(conf[a], m_confThresholdH))
+      continue;
+
+    confOut[a] = halfKernel::toFloat(conf[a]);
+    clsOut[a] = std::round(halfKernel::toFloat(cls[a]));
+    for (int k = 0; k < m_boxDim; k++)
+    {
+      size_t idx = a * anchorStride + k * valueStride;
+      boxOut[idx] = halfKernel::toFloat(box[idx]);
+    }
+    numPassed++;
+  }
+
+  return numPassed;
+}
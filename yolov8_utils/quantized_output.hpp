@@ -0,0 +1,85 @@
+#ifndef __QUANTIZED_OUTPUT__
+#define __QUANTIZED_OUTPUT__
+
+#include <stdint.h>
+
+using namespace std;
+
+
+// 8-bit affine quantization of a tensor, real = (q - zeroPoint) * step
+struct QuantParams
+{
+  float step = 1.0f;
+  int zeroPoint = 0;
+
+  float dequantize(uint8_t q) const { return (q - zeroPoint) * step; };
+
+  // Smallest quantized value whose real value reaches threshold, 256 when
+  // none does
+  int quantizeThreshold(float threshold) const;
+};
+
+
+// Front end of the detection decoder for runtimes with 8-bit or fp16
+// outputs. The confidence is compared in the stored format, and only the
+// anchors that pass get their box, confidence and class converted into the
+// float buffers the decoder reads. The others get a confidence of 0, their
+// box and class entries are left as they were.
+class QuantizedDetectionFilter
+{
+ public:
+  QuantizedDetectionFilter();
+  ~QuantizedDetectionFilter();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  // boxAnchorMajor: det_box is [anchors, boxDim], otherwise [boxDim, anchors].
+  // The quantization parameters are ignored by runHalf().
+  void setParams(
+    const QuantParams &box,
+    const QuantParams &conf,
+    const QuantParams &cls,
+    int numAnchors,
+    int boxDim,
+    bool boxAnchorMajor);
+
+  // Returns the number of anchors above confThreshold
+  int run(
+    const uint8_t *box,
+    const uint8_t *conf,
+    const uint8_t *cls,
+    float confThreshold,
+    float *boxOut,
+    float *confOut,
+    float *clsOut);
+
+  // Same for fp16 outputs (see halfKernel)
+  int runHalf(
+    const uint16_t *box,
+    const uint16_t *conf,
+    const uint16_t *cls,
+    float confThreshold,
+    float *boxOut,
+    float *confOut,
+    float *clsOut);
+
+ private:
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  QuantParams m_box;
+  QuantParams m_conf;
+  QuantParams m_cls;
+  int m_numAnchors = 0;
+  int m_boxDim = 0;
+  bool m_boxAnchorMajor = true;
+
+  // Quantized value matching the last confidence threshold
+  float m_confThreshold = -1.0f;
+  int m_confThresholdQ = 0;
+  float m_halfThreshold = -1.0f;
+  uint16_t m_confThresholdH = 0;
+};
+
+#endif
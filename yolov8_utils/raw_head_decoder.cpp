@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#include "raw_head_decoder.hpp"
+
+
+// exp(x) for x <= 0 as 2^n * 2^f, 2^f by a 5th order polynomial. Relative
+// error is below 1e-4, plenty for the bin weights, and it has no branches
+// so the 16-bin loops below vectorize.
+static inline float _fastExp(float x)
+{
+  float t = std::max(x, -87.0f) * 1.44269504f;
+  float n = std::floor(t);
+  float f = t - n;
+  float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f + f * (0.00961813f + f * 0.00133336f))));
+
+  int32_t bits;
+  std::memcpy(&bits, &p, sizeof(bits));
+  bits += (int32_t)n * (1 << 23);
+  std::memcpy(&p, &bits, sizeof(p));
+
+  return p;
+}
+
+
+// Expected distance of each box side: softmax over the DFL_BINS logits,
+// then the probability weighted bin index
+static inline void _dflExpectation(const float *logits, float *dist)
+{
+  for (int side = 0; side < 4; side++)
+  {
+    const float *v = logits + side * DFL_BINS;
+
+    float maxV = v[0];
+    for (int i = 1; i < DFL_BINS; i++)
+    {
+      maxV = std::max(maxV, v[i]);
+    }
+
+    float sum = 0.0f;
+    float weighted = 0.0f;
+    for (int i = 0; i < DFL_BINS; i++)
+    {
+      float e = _fastExp(v[i] - maxV);
+      sum += e;
+      weighted += e * (float)i;
+    }
+
+    dist[side] = weighted / sum;
+  }
+}
+
+
+static inline int _clampInt(float v, int maxV)
+{
+  int i = (int)std::lround(v);
+  return i < 0 ? 0 : (i > maxV ? maxV : i);
+}
+
+
+/////////////////////////
+// public member functions
+////////////////////////
+RawHeadDecoder::RawHeadDecoder(int inputWidth, int inputHeight, int numClasses)
+{
+  m_numClasses = numClasses;
+  setInputSize(inputWidth, inputHeight);
+};
+
+
+RawHeadDecoder::~RawHeadDecoder()
+{
+};
+
+
+void RawHeadDecoder::setInputSize(int inputWidth, int inputHeight)
+{
+  if (inputWidth == m_inputWidth && inputHeight == m_inputHeight)
+    return;
+
+  m_inputWidth = inputWidth;
+  m_inputHeight = inputHeight;
+  _buildAnchors();
+}
+
+
+int RawHeadDecoder::decode(const float *raw, float confThreshold, vector<struct v8xyxy> &candidates)
+{
+  candidates.clear();
+  m_lastDropped = 0;
+  if (raw == nullptr || m_numClasses <= 0)
+    return 0;
+
+  // Sigmoid is monotonic, so candidates are rejected on the raw logit
+  if (confThreshold != m_confThreshold)
+  {
+    float conf = std::min(std::max(confThreshold, 1e-6f), 1.0f - 1e-6f);
+    m_logitThreshold = std::log(conf / (1.0f - conf));
+    m_confThreshold = confThreshold;
+  }
+
+  int numChannels = getNumChannels();
+  int numAnchors = getNumAnchors();
+
+  // Distance between two anchors and between two channels of one anchor
+  size_t anchorStep = m_channelMajor ? 1 : (size_t)numChannels;
+  size_t channelStep = m_channelMajor ? (size_t)numAnchors : 1;
+
+  for (int a = 0; a < numAnchors; a++)
+  {
+    const float *anchor = raw + (size_t)a * anchorStep;
+    const float *cls = anchor + 4 * DFL_BINS * channelStep;
+
+    int bestClass = 0;
+    float bestLogit = cls[0];
+    for (int c = 1; c < m_numClasses; c++)
+    {
+      if (cls[c * channelStep] > bestLogit)
+      {
+        bestLogit = cls[c * channelStep];
+        bestClass = c;
+      }
+    }
+
+    if (bestLogit < m_logitThreshold)
+      continue;
+
+    // Channel major logits are gathered first, only for the few anchors
+    // that pass, so that the bin loops stay contiguous
+    float logits[4 * DFL_BINS];
+    const float *boxLogits = anchor;
+    if (m_channelMajor)
+    {
+      for (int i = 0; i < 4 * DFL_BINS; i++)
+      {
+        logits[i] = anchor[i * channelStep];
+      }
+      boxLogits = logits;
+    }
+
+    float dist[4];
+    _dflExpectation(boxLogits, dist);
+
+    float stride = m_stride[a];
+    struct v8xyxy box;
+    box.x1 = _clampInt((m_anchorX[a] - dist[0]) * stride, m_inputWidth - 1);
+    box.y1 = _clampInt((m_anchorY[a] - dist[1]) * stride, m_inputHeight - 1);
+    box.x2 = _clampInt((m_anchorX[a] + dist[2]) * stride, m_inputWidth - 1);
+    box.y2 = _clampInt((m_anchorY[a] + dist[3]) * stride, m_inputHeight - 1);
+    box.c = bestClass;
+    box.c_prob = 1.0f / (1.0f + std::exp(-bestLogit));
+
+    candidates.push_back(box);
+  }
+
+  if (m_maxCandidates > 0 && (int)candidates.size() > m_maxCandidates)
+  {
+    m_lastDropped = (int)candidates.size() - m_maxCandidates;
+    std::nth_element(candidates.begin(), candidates.begin() + m_maxCandidates, candidates.end(),
+      [](const struct v8xyxy &a, const struct v8xyxy &b) { return a.c_prob > b.c_prob; });
+    candidates.resize(m_maxCandidates);
+  }
+
+  return (int)candidates.size();
+}
+
+
+/////////////////////////
+// private member functions
+////////////////////////
+void RawHeadDecoder::_buildAnchors()
+{
+  m_anchorX.clear();
+  m_anchorY.clear();
+  m_stride.clear();
+
+  for (int stride = 8; stride <= 32; stride *= 2)
+  {
+    int gridW = m_inputWidth / stride;
+    int gridH = m_inputHeight / stride;
+    for (int gy = 0; gy < gridH; gy++)
+    {
+      for (int gx = 0; gx < gridW; gx++)
+      {
+        m_anchorX.push_back(gx + 0.5f);
+        m_anchorY.push_back(gy + 0.5f);
+        m_stride.push_back((float)stride);
+      }
+    }
+  }
+}
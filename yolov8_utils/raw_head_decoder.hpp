@@ -0,0 +1,71 @@
+#ifndef __RAW_HEAD_DECODER__
+#define __RAW_HEAD_DECODER__
+
+#include <vector>
+
+#include "yolo_adas_decoder.hpp"
+
+using namespace std;
+
+
+// Bins of the YOLOv8 box distribution (DFL)
+#define DFL_BINS 16
+
+
+// Decodes the raw YOLOv8 detection head, i.e. a model exported without the
+// box / score post-processing subgraph. The head output holds, for every
+// candidate of the stride 8, 16 and 32 grids (in that order, row major):
+// 4 x DFL_BINS box distribution logits (left, top, right, bottom) followed
+// by one logit per class. The output is either [1, anchors, channels], or
+// channel major [1, channels, anchors] as most exports leave it.
+class RawHeadDecoder
+{
+ public:
+  RawHeadDecoder(int inputWidth, int inputHeight, int numClasses);
+  ~RawHeadDecoder();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  // Candidates above confThreshold in network input coordinates, not yet
+  // suppressed. Returns the number of candidates.
+  int decode(const float *raw, float confThreshold, vector<struct v8xyxy> &candidates);
+
+  void setInputSize(int inputWidth, int inputHeight);
+  void setChannelMajor(bool channelMajor) { m_channelMajor = channelMajor; };
+  bool isChannelMajor() { return m_channelMajor; };
+  int getNumAnchors() { return (int)m_anchorX.size(); };
+  int getNumChannels() { return 4 * DFL_BINS + m_numClasses; };
+
+  // Candidates kept past the threshold, highest scores first, 0 for no
+  // cap. The ones cut by the last decode are counted.
+  void setMaxCandidates(int maxCandidates) { m_maxCandidates = maxCandidates; };
+  int getMaxCandidates() { return m_maxCandidates; };
+  int getLastDropped() { return m_lastDropped; };
+
+ private:
+  void _buildAnchors();
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  int m_inputWidth = 0;
+  int m_inputHeight = 0;
+  int m_numClasses = 0;
+  bool m_channelMajor = false;
+
+  // Per candidate, for the current input size
+  vector<float> m_anchorX;    // cell center, grid units
+  vector<float> m_anchorY;
+  vector<float> m_stride;
+
+  // Class logit matching the last confidence threshold
+  float m_confThreshold = -1.0f;
+  float m_logitThreshold = 0.0f;
+
+  // Kept before NMS, highest scores first
+  int m_maxCandidates = 1024;
+  int m_lastDropped = 0;
+};
+
+#endif
@@ -0,0 +1,546 @@
+#include <string.h>
+#include <iostream>
+
+#include "tensor_record.hpp"
+
+
+#define LZ4_HASH_LOG 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_SKIP_TRIGGER 6
+
+
+static uint32_t _read32(const uint8_t *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+
+static uint32_t _hash(uint32_t v)
+{
+  return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+
+static uint8_t *_writeLength(uint8_t *op, size_t len)
+{
+  while (len >= 255)
+  {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+
+static uint8_t *_writeSequence(
+  uint8_t *op, const uint8_t *literal, size_t litLen, size_t offset, size_t matchLen)
+{
+  uint8_t *token = op++;
+
+  *token = (uint8_t)((litLen >= 15 ? 15 : litLen) << 4);
+  if (litLen >= 15)
+    op = _writeLength(op, litLen - 15);
+  if (litLen > 0)
+    memcpy(op, literal, litLen);
+  op += litLen;
+
+  // The last sequence of a block only has literals
+  if (offset == 0)
+    return op;
+
+  *op++ = (uint8_t)(offset & 0xff);
+  *op++ = (uint8_t)(offset >> 8);
+  matchLen -= LZ4_MIN_MATCH;
+  *token |= (uint8_t)(matchLen >= 15 ? 15 : matchLen);
+  if (matchLen >= 15)
+    op = _writeLength(op, matchLen - 15);
+
+  return op;
+}
+
+
+static bool _readLength(const uint8_t *&ip, const uint8_t *iend, size_t &len)
+{
+  uint8_t b;
+  do
+  {
+    if (ip >= iend)
+      return false;
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+
+  return true;
+}
+
+
+size_t lz4BlockBound(size_t srcSize)
+{
+  return srcSize + srcSize / 255 + 16;
+}
+
+
+size_t lz4BlockCompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity)
+{
+  if (dstCapacity < lz4BlockBound(srcSize))
+    return 0;
+
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  const uint8_t *end = src + srcSize;
+  uint8_t *op = dst;
+
+  if (srcSize > LZ4_MF_LIMIT)
+  {
+    // Matches start before mfLimit and stop before the last literals
+    const uint8_t *mfLimit = end - LZ4_MF_LIMIT;
+    const uint8_t *matchLimit = end - LZ4_LAST_LITERALS;
+    vector<int64_t> table(1 << LZ4_HASH_LOG, -1);
+    uint32_t misses = 0;
+
+    while (ip < mfLimit)
+    {
+      uint32_t seq = _read32(ip);
+      uint32_t h = _hash(seq);
+      int64_t ref = table[h];
+      table[h] = ip - src;
+
+      if (ref < 0 || (ip - src) - ref > LZ4_MAX_OFFSET || _read32(src + ref) != seq)
+      {
+        // Step faster over data that doesn't compress (float noise mostly)
+        ip += 1 + (misses++ >> LZ4_SKIP_TRIGGER);
+        continue;
+      }
+      misses = 0;
+
+      const uint8_t *match = src + ref;
+      const uint8_t *mp = ip + LZ4_MIN_MATCH;
+      const uint8_t *rp = match + LZ4_MIN_MATCH;
+      while (mp < matchLimit && *mp == *rp)
+      {
+        mp++;
+        rp++;
+      }
+
+      op = _writeSequence(op, anchor, ip - anchor, ip - match, mp - ip);
+      ip = mp;
+      anchor = ip;
+    }
+  }
+
+  op = _writeSequence(op, anchor, end - anchor, 0, 0);
+
+  return op - dst;
+}
+
+
+size_t lz4BlockDecompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize)
+{
+  const uint8_t *ip = src;
+  const uint8_t *iend = src + srcSize;
+  uint8_t *op = dst;
+  uint8_t *oend = dst + dstSize;
+
+  while (ip < iend)
+  {
+    uint8_t token = *ip++;
+
+    size_t litLen = token >> 4;
+    if (litLen == 15 && !_readLength(ip, iend, litLen))
+      return 0;
+    if ((size_t)(iend - ip) < litLen || (size_t)(oend - op) < litLen)
+      return 0;
+    memcpy(op, ip, litLen);
+    op += litLen;
+    ip += litLen;
+
+    if (ip == iend)
+      break;
+
+    if (iend - ip < 2)
+      return 0;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return 0;
+
+    size_t matchLen = token & 15;
+    if (matchLen == 15 && !_readLength(ip, iend, matchLen))
+      return 0;
+    matchLen += LZ4_MIN_MATCH;
+    if ((size_t)(oend - op) < matchLen)
+      return 0;
+
+    // Overlapping matches repeat the last offset bytes
+    const uint8_t *match = op - offset;
+    if (offset >= matchLen)
+    {
+      memcpy(op, match, matchLen);
+    }
+    else
+    {
+      for (size_t i = 0; i < matchLen; i++)
+        op[i] = match[i];
+    }
+    op += matchLen;
+  }
+
+  return op - dst;
+}
+
+
+const RecordedTensor *RecordedFrame::find(const string &name) const
+{
+  for (size_t i = 0; i < tensors.size(); i++)
+  {
+    if (strncmp(tensors[i].desc.name, name.c_str(), TENSOR_RECORD_NAME_LEN) == 0)
+      return &tensors[i];
+  }
+
+  return nullptr;
+}
+
+
+/////////////////////////
+// TensorRecordWriter
+////////////////////////
+TensorRecordWriter::TensorRecordWriter(const string &filePath, bool compress, size_t chunkSize)
+{
+  m_filePath = filePath;
+  m_compress = compress;
+  m_chunkSize = chunkSize;
+  m_chunk.reserve(m_chunkSize);
+};
+
+
+TensorRecordWriter::~TensorRecordWriter()
+{
+  close();
+};
+
+
+bool TensorRecordWriter::isOpen()
+{
+  return m_file != nullptr;
+}
+
+
+uint64_t TensorRecordWriter::getFrameCount()
+{
+  return m_frameCount;
+}
+
+
+uint64_t TensorRecordWriter::getRawBytes()
+{
+  return m_rawBytes;
+}
+
+
+uint64_t TensorRecordWriter::getStoredBytes()
+{
+  return m_storedBytes;
+}
+
+
+bool TensorRecordWriter::beginFrame(uint64_t seq, int64_t timestampUs, const uint32_t inputShape[4], uint32_t stream)
+{
+  if (m_failed || m_inFrame)
+    return false;
+
+  if (m_file == nullptr && !_open())
+    return false;
+
+  TensorFrameHeader header;
+  memset(&header, 0, sizeof(header));
+  header.seq = seq;
+  header.timestampUs = timestampUs;
+  memcpy(header.inputShape, inputShape, sizeof(header.inputShape));
+  header.stream = stream;
+
+  m_frameOffset = m_chunk.size();
+  m_chunk.insert(m_chunk.end(), (const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+  m_inFrame = true;
+
+  return true;
+}
+
+
+bool TensorRecordWriter::addTensor(
+  const string &name,
+  uint32_t dtype,
+  const uint32_t shape[4],
+  uint32_t pitch,
+  const void *data,
+  uint64_t size)
+{
+  if (!m_inFrame)
+    return false;
+
+  TensorDesc desc;
+  memset(&desc, 0, sizeof(desc));
+  strncpy(desc.name, name.c_str(), TENSOR_RECORD_NAME_LEN - 1);
+  desc.dtype = dtype;
+  desc.pitch = pitch;
+  memcpy(desc.shape, shape, sizeof(desc.shape));
+  desc.size = size;
+
+  m_chunk.insert(m_chunk.end(), (const uint8_t *)&desc, (const uint8_t *)&desc + sizeof(desc));
+  m_chunk.insert(m_chunk.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+
+  // Tensor count of the frame header is patched in place
+  TensorFrameHeader *header = (TensorFrameHeader *)&m_chunk[m_frameOffset];
+  uint32_t tensorCount;
+  memcpy(&tensorCount, &header->tensorCount, sizeof(tensorCount));
+  tensorCount++;
+  memcpy(&header->tensorCount, &tensorCount, sizeof(tensorCount));
+
+  return true;
+}
+
+
+bool TensorRecordWriter::endFrame()
+{
+  if (!m_inFrame)
+    return false;
+
+  m_inFrame = false;
+  m_chunkFrames++;
+  m_frameCount++;
+
+  if (m_chunk.size() >= m_chunkSize)
+    return _flushChunk();
+
+  return true;
+}
+
+
+bool TensorRecordWriter::close()
+{
+  if (m_file == nullptr)
+    return !m_failed;
+
+  // A frame left open is dropped
+  if (m_inFrame)
+  {
+    m_chunk.resize(m_frameOffset);
+    m_inFrame = false;
+  }
+  _flushChunk();
+
+  fclose(m_file);
+  m_file = nullptr;
+
+  return !m_failed;
+}
+
+
+bool TensorRecordWriter::_open()
+{
+  m_file = fopen(m_filePath.c_str(), "wb");
+  if (m_file == nullptr)
+  {
+    cerr << "[TensorRecord] can't create " << m_filePath << endl;
+    m_failed = true;
+    return false;
+  }
+
+  TensorRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TENSOR_RECORD_MAGIC, sizeof(header.magic));
+  header.version = TENSOR_RECORD_VERSION;
+  header.flags = m_compress ? TENSOR_RECORD_COMPRESS : 0;
+  if (fwrite(&header, sizeof(header), 1, m_file) != 1)
+  {
+    m_failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+
+bool TensorRecordWriter::_flushChunk()
+{
+  if (m_chunkFrames == 0)
+    return true;
+
+  TensorChunkHeader header;
+  memset(&header, 0, sizeof(header));
+  header.rawSize = m_chunk.size();
+  header.storedSize = m_chunk.size();
+  header.frameCount = m_chunkFrames;
+
+  const uint8_t *payload = &m_chunk[0];
+  if (m_compress)
+  {
+    m_packed.resize(lz4BlockBound(m_chunk.size()));
+    size_t packedSize = lz4BlockCompress(&m_chunk[0], m_chunk.size(), &m_packed[0], m_packed.size());
+
+    // Chunks that don't shrink are stored as is
+    if (packedSize > 0 && packedSize < m_chunk.size())
+    {
+      header.storedSize = packedSize;
+      payload = &m_packed[0];
+    }
+  }
+
+  if (fwrite(&header, sizeof(header), 1, m_file) != 1 ||
+      fwrite(payload, 1, header.storedSize, m_file) != header.storedSize)
+  {
+    cerr << "[TensorRecord] failed to write " << m_filePath << endl;
+    m_failed = true;
+  }
+
+  m_rawBytes += header.rawSize;
+  m_storedBytes += header.storedSize + sizeof(header);
+  m_chunk.clear();
+  m_chunkFrames = 0;
+
+  return !m_failed;
+}
+
+
+/////////////////////////
+// TensorRecordReader
+////////////////////////
+TensorRecordReader::TensorRecordReader()
+{
+  memset(&m_header, 0, sizeof(m_header));
+};
+
+
+TensorRecordReader::~TensorRecordReader()
+{
+  close();
+};
+
+
+bool TensorRecordReader::open(const string &filePath)
+{
+  close();
+  m_file = fopen(filePath.c_str(), "rb");
+  if (m_file == nullptr)
+  {
+    cerr << "[TensorRecord] can't open " << filePath << endl;
+    return false;
+  }
+
+  if (fread(&m_header, sizeof(m_header), 1, m_file) != 1 ||
+      memcmp(m_header.magic, TENSOR_RECORD_MAGIC, sizeof(m_header.magic)) != 0 ||
+      m_header.version != TENSOR_RECORD_VERSION)
+  {
+    cerr << "[TensorRecord] " << filePath << " is not a tensor record" << endl;
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+
+void TensorRecordReader::close()
+{
+  if (m_file != nullptr)
+    fclose(m_file);
+
+  m_file = nullptr;
+  memset(&m_header, 0, sizeof(m_header));
+  m_chunk.clear();
+  m_chunkPos = 0;
+  m_chunkFramesLeft = 0;
+}
+
+
+bool TensorRecordReader::rewind()
+{
+  if (m_file == nullptr || fseek(m_file, sizeof(m_header), SEEK_SET) != 0)
+    return false;
+
+  m_chunk.clear();
+  m_chunkPos = 0;
+  m_chunkFramesLeft = 0;
+
+  return true;
+}
+
+
+bool TensorRecordReader::next(RecordedFrame &frame)
+{
+  if (m_file == nullptr)
+    return false;
+
+  while (m_chunkFramesLeft == 0)
+  {
+    if (!_loadChunk())
+      return false;
+  }
+
+  if (m_chunk.size() - m_chunkPos < sizeof(TensorFrameHeader))
+    return false;
+  memcpy(&frame.header, &m_chunk[m_chunkPos], sizeof(TensorFrameHeader));
+  m_chunkPos += sizeof(TensorFrameHeader);
+
+  frame.tensors.resize(frame.header.tensorCount);
+  for (uint32_t i = 0; i < frame.header.tensorCount; i++)
+  {
+    RecordedTensor &tensor = frame.tensors[i];
+    if (m_chunk.size() - m_chunkPos < sizeof(TensorDesc))
+      return false;
+    memcpy(&tensor.desc, &m_chunk[m_chunkPos], sizeof(TensorDesc));
+    tensor.desc.name[TENSOR_RECORD_NAME_LEN - 1] = '\0';
+    m_chunkPos += sizeof(TensorDesc);
+
+    if (m_chunk.size() - m_chunkPos < tensor.desc.size)
+      return false;
+    tensor.data = &m_chunk[m_chunkPos];
+    m_chunkPos += tensor.desc.size;
+  }
+  m_chunkFramesLeft--;
+
+  return true;
+}
+
+
+bool TensorRecordReader::_loadChunk()
+{
+  TensorChunkHeader header;
+
+  if (fread(&header, sizeof(header), 1, m_file) != 1)
+    return false;
+
+  if (header.storedSize > header.rawSize || (header.storedSize == 0 && header.rawSize > 0))
+  {
+    cerr << "[TensorRecord] corrupted chunk" << endl;
+    return false;
+  }
+
+  m_chunk.resize(header.rawSize);
+  m_chunkPos = 0;
+  m_chunkFramesLeft = 0;
+  if (header.storedSize == header.rawSize)
+  {
+    if (header.rawSize > 0 && fread(&m_chunk[0], 1, header.rawSize, m_file) != header.rawSize)
+      return false;
+  }
+  else
+  {
+    m_packed.resize(header.storedSize);
+    if (header.storedSize > 0 && fread(&m_packed[0], 1, header.storedSize, m_file) != header.storedSize)
+      return false;
+    if (lz4BlockDecompress(&m_packed[0], m_packed.size(), &m_chunk[0], m_chunk.size()) != header.rawSize)
+    {
+      cerr << "[TensorRecord] corrupted compressed chunk" << endl;
+      return false;
+    }
+  }
+  m_chunkFramesLeft = header.frameCount;
+
+  return true;
+}
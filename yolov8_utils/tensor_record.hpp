@@ -0,0 +1,162 @@
+#ifndef __TENSOR_RECORD__
+#define __TENSOR_RECORD__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// Network output recording for deterministic replay of the postprocessing:
+//   [file header][chunk 0][chunk 1]...
+// A chunk holds the records of several frames and is optionally compressed
+// as one LZ4-style block. A frame record is
+//   [frame header][tensor desc 0][data 0][tensor desc 1][data 1]...
+#define TENSOR_RECORD_MAGIC "WNCTRECD"
+#define TENSOR_RECORD_VERSION 1
+#define TENSOR_RECORD_NAME_LEN 64
+#define TENSOR_RECORD_CHUNK_SIZE (4 << 20)
+
+enum TensorRecordFlag
+{
+  TENSOR_RECORD_COMPRESS = 1
+};
+
+struct TensorRecordHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+};
+
+struct TensorChunkHeader
+{
+  uint32_t rawSize;
+  uint32_t storedSize;   // equals rawSize when the chunk is stored as is
+  uint32_t frameCount;
+  uint32_t reserved;
+};
+
+struct TensorFrameHeader
+{
+  uint64_t seq;
+  int64_t timestampUs;
+  uint32_t inputShape[4];
+  uint32_t stream;
+  uint32_t tensorCount;
+};
+
+struct TensorDesc
+{
+  char name[TENSOR_RECORD_NAME_LEN];
+  uint32_t dtype;
+  uint32_t pitch;
+  uint32_t shape[4];
+  uint64_t size;
+};
+
+struct RecordedTensor
+{
+  TensorDesc desc;
+  const uint8_t *data;
+};
+
+struct RecordedFrame
+{
+  TensorFrameHeader header;
+  vector<RecordedTensor> tensors;
+
+  const RecordedTensor *find(const string &name) const;
+};
+
+
+// LZ4 block format, without the frame format around it
+size_t lz4BlockCompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+size_t lz4BlockDecompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+size_t lz4BlockBound(size_t srcSize);
+
+
+class TensorRecordWriter
+{
+ public:
+  TensorRecordWriter(const string &filePath, bool compress, size_t chunkSize = TENSOR_RECORD_CHUNK_SIZE);
+  ~TensorRecordWriter();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  bool beginFrame(uint64_t seq, int64_t timestampUs, const uint32_t inputShape[4], uint32_t stream = 0);
+  bool addTensor(
+    const string &name,
+    uint32_t dtype,
+    const uint32_t shape[4],
+    uint32_t pitch,
+    const void *data,
+    uint64_t size);
+  bool endFrame();
+  bool close();
+
+  bool isOpen();
+  uint64_t getFrameCount();
+  uint64_t getRawBytes();
+  uint64_t getStoredBytes();
+
+ private:
+  bool _open();
+  bool _flushChunk();
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  string m_filePath;
+  FILE *m_file = nullptr;
+  bool m_compress = false;
+  bool m_failed = false;
+  size_t m_chunkSize = TENSOR_RECORD_CHUNK_SIZE;
+
+  vector<uint8_t> m_chunk;
+  vector<uint8_t> m_packed;
+  uint32_t m_chunkFrames = 0;
+  size_t m_frameOffset = 0;
+  bool m_inFrame = false;
+
+  uint64_t m_frameCount = 0;
+  uint64_t m_rawBytes = 0;
+  uint64_t m_storedBytes = 0;
+};
+
+
+class TensorRecordReader
+{
+ public:
+  TensorRecordReader();
+  ~TensorRecordReader();
+
+  ///////////////////////////
+  /// Member Functions
+  //////////////////////////
+  bool open(const string &filePath);
+  void close();
+  bool rewind();
+
+  // Tensor data points into the current chunk, valid until the next call
+  bool next(RecordedFrame &frame);
+
+ private:
+  bool _loadChunk();
+
+  ///////////////////////////
+  /// Member Variables
+  //////////////////////////
+  FILE *m_file = nullptr;
+  TensorRecordHeader m_header;
+
+  vector<uint8_t> m_chunk;
+  vector<uint8_t> m_packed;
+  size_t m_chunkPos = 0;
+  uint32_t m_chunkFramesLeft = 0;
+};
+
+#endif
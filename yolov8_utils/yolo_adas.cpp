@@ -51,10 +51,26 @@ const std::vector<cv::Scalar> line_colors = {
 };
 
 
+// ADAS_Config_S::detectionCapacity (the detection capacity of the config
+// file) when dla_config.hpp has it, 0 with an older one
+template <typename Config>
+static auto _configDetectionCapacity(const Config *config, int) -> decltype((int)config->detectionCapacity)
+{
+  return (int)config->detectionCapacity;
+}
+
+
+template <typename Config>
+static int _configDetectionCapacity(const Config *config, long)
+{
+  return 0;
+}
+
+
 /////////////////////////
 // public member functions
 ////////////////////////
-YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
+YOLOADAS::YOLOADAS(ADAS_Config_S *config, int detectionCapacity)  // main function
 {
   auto m_logger = spdlog::stdout_color_mt("YOLO-ADAS");
   m_logger->set_pattern("[%n] [%^%l%$] %v");
@@ -85,6 +101,11 @@ YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
   {
     runtime = zdl::DlSystem::Runtime_t::GPU;
   }
+  else if (rumtimeStr == "gpu_fp16")
+  {
+    // fp16 compute, the detection outputs are kept in fp16 as well
+    runtime = zdl::DlSystem::Runtime_t::GPU_FLOAT16;
+  }
   else if (rumtimeStr == "aip")
   {
     runtime = zdl::DlSystem::Runtime_t::AIP_FIXED8_TF;
@@ -113,6 +134,14 @@ YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
   runtime = checkRuntime(runtime, staticQuantization);
   runtimeList.add(runtime);
 
+  // The fixed point runtimes quantize the input to 8 bits anyway, so feed
+  // them 8-bit pixels instead of normalized floats
+  m_inputU8 = (runtime == zdl::DlSystem::Runtime_t::AIP_FIXED8_TF || runtime == zdl::DlSystem::Runtime_t::DSP);
+  m_halfOutput = (runtime == zdl::DlSystem::Runtime_t::GPU_FLOAT16);
+  m_useUserBuffers = m_inputU8 || m_halfOutput;
+  useUserSuppliedBuffers = m_useUserBuffers;
+  m_logger->info("Input Type = {}", m_inputU8 ? "uint8" : "float32");
+
   // STEP2: Create Deep Learning Container and Load Network File
   m_logger->info("DLC File Path = {}",  dlcFilePath);
   std::unique_ptr<zdl::DlContainer::IDlContainer> container = loadContainerFromFile(dlcFilePath);
@@ -127,6 +156,16 @@ YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
   m_snpe = setBuilderOptions(
     container, runtimeList, useUserSuppliedBuffers, m_outputTensorList, platformConfig, usingInitCaching);
 
+  if (m_snpe == nullptr)
+  {
+    // No decoded detection outputs, try a model exported with the raw head
+    m_logger->info("Decoded detection outputs not found, trying the raw detection head");
+    m_outputTensorList = m_rawOutputTensorList;
+    m_snpe = setBuilderOptions(
+      container, runtimeList, useUserSuppliedBuffers, m_outputTensorList, platformConfig, usingInitCaching);
+    m_rawHead = (m_snpe != nullptr);
+  }
+
   if (m_snpe == nullptr)
   {
     m_logger->error("Error while building SNPE object.");
@@ -146,6 +185,11 @@ YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
 
   // STEP4: Init Model Input/Output Tensor
   _initModelIO();
+  if (m_useUserBuffers && !_initUserBuffers())
+  {
+    m_logger->error("Error while creating user buffers.");
+    std::exit(1);
+  }
 
   // STEP5: Parameters Initialization
   m_prevLeftX = 0;
@@ -158,7 +202,27 @@ YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
   m_laneLineCalib = new LaneLineCalib(config); //TODO:
 
   // Output Decoder
-  m_decoder = new YOLOADAS_Decoder(m_inputHeight, m_inputWidth);
+  m_nmsParams.defaults.confThreshold = confidenceThreshold;
+  m_nmsParams.defaults.iouThreshold = iouThreshold;
+  if (detectionCapacity <= 0)
+    detectionCapacity = _configDetectionCapacity(config, 0);
+  if (detectionCapacity <= 0)
+    detectionCapacity = MAX_YOLO_BBX;
+  m_yoloOut.setCapacity(detectionCapacity);
+  m_logger->info("Detection Capacity = {}", detectionCapacity);
+  if (m_rawHead)
+  {
+    m_rawDecoder = new RawHeadDecoder(m_inputWidth, m_inputHeight, m_modelShape.numClasses);
+    m_rawDecoder->setChannelMajor(m_modelShape.rawChannelMajor);
+  }
+  else
+  {
+    m_boxDecoder = new BoxHeadDecoder(m_inputWidth, m_inputHeight, m_modelShape.numClasses);
+    m_boxDecoder->setLayout(m_modelShape.numAnchors, m_modelShape.boxDim, m_modelShape.boxAnchorMajor);
+  }
+
+  // NV12 input, straight to the NHWC input tensor
+  m_preprocessor = new FusedPreprocessor(m_inputWidth, m_inputHeight, PREPROC_NHWC);
 
   // Bird Eye View (Optional)
   if (m_enableBEV)
@@ -204,21 +268,31 @@ YOLOADAS::YOLOADAS(ADAS_Config_S *config)  // main function
 
 YOLOADAS::~YOLOADAS()  // clear object memory
 {
-  delete m_decoder;
-  delete m_laneBuff;
-  delete m_lineBuff;
-  delete m_detectionBoxBuff;
-  delete m_detectionConfBuff;
-  delete m_detectionClsBuff;
+  delete m_boxDecoder;
+  delete[] m_laneBuff;
+  delete[] m_lineBuff;
+  delete[] m_detectionBoxBuff;
+  delete[] m_detectionConfBuff;
+  delete[] m_detectionClsBuff;
+  delete m_rawDecoder;
+  delete[] m_detectionRawBuff;
   delete m_laneLineCalib;
+  delete m_prefetcher;
+  delete m_recorder;
+  delete m_preprocessor;
 
-  m_decoder = nullptr;
+  m_boxDecoder = nullptr;
   m_laneBuff = nullptr;
   m_lineBuff = nullptr;
   m_detectionBoxBuff = nullptr;
   m_detectionConfBuff = nullptr;
   m_detectionClsBuff = nullptr;
+  m_rawDecoder = nullptr;
+  m_detectionRawBuff = nullptr;
   m_laneLineCalib = nullptr;
+  m_prefetcher = nullptr;
+  m_recorder = nullptr;
+  m_preprocessor = nullptr;
 };
 
 void YOLOADAS::close()
@@ -260,6 +334,7 @@ bool YOLOADAS::_initModelIO()
     so that we can check that the input contains the expected number of elements.
     With the input dimensions computed create a tensor to convey the input into the network. */
   m_inputTensor = zdl::SNPE::SNPEFactory::getTensorFactory().createTensor(inputShape);
+  m_inputTensorName = inputTensorNames.at(0);
 
   // Create a buffer to store image data
   m_inputBuff.resize(m_inputChannel*m_inputHeight*m_inputWidth);
@@ -267,20 +342,320 @@ bool YOLOADAS::_initModelIO()
   m_logger->info("Create Model Output Buffers");
   m_logger->info("-------------------------------------------");
 
-  m_detectionBoxSize = 5 * NUM_BBOX;
-  m_detectionConfSize = NUM_BBOX;
-  m_detectionClassSize = NUM_BBOX;
-  m_detectionBoxBuff = new float[m_detectionBoxSize];
-  m_detectionConfBuff = new float[m_detectionConfSize];
-  m_detectionClsBuff = new float[m_detectionClassSize];
+  // All sizes come from the model, so any exported input size works
+  std::vector<size_t> lineDims;
+  if (!_getTensorDims(m_outputTensorList[0], lineDims))
+    throw std::runtime_error("Error obtaining output tensor dimensions");
+
+  if (lineDims.size() < 3)
+    throw std::runtime_error("Unexpected lane line output rank");
+
+  m_modelShape.inputWidth = m_inputWidth;
+  m_modelShape.inputHeight = m_inputHeight;
+  m_modelShape.inputChannel = m_inputChannel;
+  m_modelShape.segHeight = (int)lineDims[1];
+  m_modelShape.segWidth = (int)lineDims[2];
+  m_modelShape.rawHead = m_rawHead;
+
+  if (m_rawHead)
+  {
+    // det_raw: [1, anchors, 4 * DFL_BINS + classes], or channel major
+    // [1, 4 * DFL_BINS + classes, anchors]. The anchor count of the input
+    // size tells which one it is.
+    std::vector<size_t> rawDims;
+    if (!_getTensorDims(m_outputTensorList[2], rawDims) || rawDims.empty())
+      throw std::runtime_error("Error obtaining output tensor dimensions");
+
+    int expectedAnchors = ModelShape::anchorCount(m_inputWidth, m_inputHeight);
+    m_detectionRawSize = (int)_getElementCount(rawDims);
+    m_modelShape.rawChannelMajor = (int)rawDims.back() == expectedAnchors &&
+      (rawDims.size() < 2 || (int)rawDims[rawDims.size() - 2] != expectedAnchors);
+
+    int numChannels = m_modelShape.rawChannelMajor ?
+      m_detectionRawSize / expectedAnchors : (int)rawDims.back();
+    m_modelShape.numAnchors = m_detectionRawSize / numChannels;
+    m_modelShape.boxDim = 4 * DFL_BINS;
+    m_modelShape.numClasses = numChannels - 4 * DFL_BINS;
+    if (m_modelShape.numClasses <= 0)
+      throw std::runtime_error("Unexpected raw detection head layout, expecting anchors x channels or channels x anchors");
+
+    m_detectionRawBuff = new float[m_detectionRawSize];
+  }
+  else
+  {
+    std::vector<size_t> boxDims, confDims, clsDims;
+    if (!_getTensorDims(m_outputTensorList[2], boxDims) ||
+        !_getTensorDims(m_outputTensorList[3], confDims) ||
+        !_getTensorDims(m_outputTensorList[4], clsDims))
+    {
+      throw std::runtime_error("Error obtaining output tensor dimensions");
+    }
+
+    m_modelShape.numAnchors = (int)_getElementCount(confDims);
+    m_modelShape.boxDim = m_modelShape.numAnchors > 0 ?
+      (int)(_getElementCount(boxDims) / m_modelShape.numAnchors) : 0;
+    // det_cls holds one class id per candidate, the class count isn't part
+    // of the outputs: ids are taken as emitted, see BoxHeadDecoder
+    m_modelShape.numClasses = 0;
+    m_modelShape.boxAnchorMajor = !boxDims.empty() && (int)boxDims.back() == m_modelShape.boxDim;
+    if (m_modelShape.boxDim < 4)
+      throw std::runtime_error("Unexpected det_box layout, expecting x1, y1, x2, y2 per candidate");
+
+    m_detectionBoxSize = (int)_getElementCount(boxDims);
+    m_detectionConfSize = (int)_getElementCount(confDims);
+    m_detectionClassSize = (int)_getElementCount(clsDims);
+    m_detectionBoxBuff = new float[m_detectionBoxSize];
+    m_detectionConfBuff = new float[m_detectionConfSize];
+    m_detectionClsBuff = new float[m_detectionClassSize];
+  }
+  m_logger->info("Model: {}", m_modelShape.toString());
+
+  if (m_modelShape.numAnchors != ModelShape::anchorCount(m_inputWidth, m_inputHeight))
+  {
+    m_logger->warn("{} detection candidates, a {}x{} input has {}",
+      m_modelShape.numAnchors, m_inputHeight, m_inputWidth, ModelShape::anchorCount(m_inputWidth, m_inputHeight));
+
+    // The raw decoder walks the anchor grid of the input size
+    if (m_rawHead)
+      throw std::runtime_error("Raw detection head doesn't match the input size");
+  }
+
+  m_laneBuff = new float [m_modelShape.segSize()];
+  m_lineBuff = new float [m_modelShape.segSize()];
+
+  return true;
+}
+
+
+bool YOLOADAS::_getTensorDims(const std::string &name, std::vector<size_t> &dims)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  auto bufferAttributesOpt = m_snpe->getInputOutputBufferAttributes(name.c_str());
+  if (!bufferAttributesOpt)
+  {
+    m_logger->error("Error obtaining attributes of tensor {}", name);
+    return false;
+  }
+
+  const zdl::DlSystem::TensorShape &shape = (*bufferAttributesOpt)->getDims();
+  dims.resize(shape.rank());
+  for (size_t d = 0; d < shape.rank(); d++)
+  {
+    dims[d] = shape[d];
+  }
+
+  return true;
+}
+
+
+size_t YOLOADAS::_getElementCount(const std::vector<size_t> &dims)
+{
+  size_t count = 1;
+  for (size_t d : dims)
+  {
+    count *= d;
+  }
+
+  return dims.empty() ? 0 : count;
+}
+
+
+bool YOLOADAS::_initUserBuffers()
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+  zdl::DlSystem::IUserBufferFactory &ubFactory = zdl::SNPE::SNPEFactory::getUserBufferFactory();
+
+  m_logger->info("Create Model User Buffers");
+  m_logger->info("-------------------------------------------");
+
+  // Input: 8-bit NHWC, quantized value q stands for q / 255
+  std::vector<size_t> inputStrides = {
+    (size_t)m_inputHeight*m_inputWidth*m_inputChannel,
+    (size_t)m_inputWidth*m_inputChannel,
+    (size_t)m_inputChannel,
+    1};
+  if (m_inputU8)
+  {
+    m_inputBuffU8.resize(m_inputChannel*m_inputHeight*m_inputWidth);
+    zdl::DlSystem::UserBufferEncodingTf8 inputEncoding(0, 1.0f / 255);
+    m_userBuffers.push_back(ubFactory.createUserBuffer(
+      &m_inputBuffU8[0], m_inputBuffU8.size(), inputStrides, &inputEncoding));
+  }
+  else
+  {
+    // Float NHWC, m_inputBuff itself
+    for (size_t d = 0; d < inputStrides.size(); d++)
+    {
+      inputStrides[d] *= sizeof(float);
+    }
+
+    zdl::DlSystem::UserBufferEncodingFloat inputEncoding;
+    m_userBuffers.push_back(ubFactory.createUserBuffer(
+      &m_inputBuff[0], m_inputBuff.size() * sizeof(float), inputStrides, &inputEncoding));
+  }
+  m_inputBufferMap.add(m_inputTensorName.c_str(), m_userBuffers.back().get());
+
+  // Outputs: float, written by the network straight into the output buffers
+  float *buffList[5];
+  int sizeList[5];
+  int numBuff = _getOutputBuffers(buffList, sizeList);
+  zdl::DlSystem::UserBufferEncodingFloat outputEncoding;
+
+  // Detection outputs the model quantizes to 8 bits stay 8-bit, the
+  // confidence threshold is applied before anything is dequantized
+  QuantParams quantParams[5];
+  m_halfOutput = m_halfOutput && !m_rawHead && numBuff == 5;
+  m_quantizedOutput = !m_halfOutput && !m_rawHead && numBuff == 5;
+  for (int i = 2; i < numBuff && m_quantizedOutput; i++)
+  {
+    m_quantizedOutput = _getOutputQuantization(m_outputTensorList[i], quantParams[i]);
+  }
+
+  if (m_quantizedOutput || m_halfOutput)
+  {
+    m_quantFilter.setParams(
+      quantParams[2], quantParams[3], quantParams[4], m_modelShape.numAnchors, m_modelShape.boxDim,
+      m_modelShape.boxAnchorMajor);
+  }
+
+  if (m_quantizedOutput)
+  {
+    m_detectionBoxQ.resize(m_detectionBoxSize);
+    m_detectionConfQ.resize(m_detectionConfSize);
+    m_detectionClsQ.resize(m_detectionClassSize);
+    m_logger->info("Detection outputs are 8-bit, conf step {}", quantParams[3].step);
+  }
+  else if (m_halfOutput)
+  {
+    m_detectionBoxH.resize(m_detectionBoxSize);
+    m_detectionConfH.resize(m_detectionConfSize);
+    m_detectionClsH.resize(m_detectionClassSize);
+    m_logger->info("Detection outputs are fp16");
+  }
+  uint8_t *quantBuffList[5] = {nullptr, nullptr, m_detectionBoxQ.data(), m_detectionConfQ.data(), m_detectionClsQ.data()};
+  uint16_t *halfBuffList[5] = {nullptr, nullptr, m_detectionBoxH.data(), m_detectionConfH.data(), m_detectionClsH.data()};
+
+  for (int i = 0; i < numBuff; i++)
+  {
+    const char *name = m_outputTensorList[i].c_str();
+    std::vector<size_t> dims;
+    if (!_getTensorDims(m_outputTensorList[i], dims))
+      return false;
+
+    std::vector<size_t> strides(dims.size());
+    size_t stride = sizeof(float);
+    for (int d = (int)dims.size() - 1; d >= 0; d--)
+    {
+      strides[d] = stride;
+      stride *= dims[d];
+    }
+
+    // stride now holds the byte size of the whole tensor
+    if (stride != sizeList[i] * sizeof(float))
+    {
+      m_logger->error("Output tensor {} holds {} values, expecting {}", name, stride / sizeof(float), sizeList[i]);
+      return false;
+    }
+
+    if (m_quantizedOutput && i >= 2)
+    {
+      // Same layout with one byte per value
+      for (size_t d = 0; d < strides.size(); d++)
+      {
+        strides[d] /= sizeof(float);
+      }
+
+      zdl::DlSystem::UserBufferEncodingTf8 quantEncoding(
+        (uint64_t)quantParams[i].zeroPoint, quantParams[i].step);
+      m_userBuffers.push_back(ubFactory.createUserBuffer(
+        quantBuffList[i], stride / sizeof(float), strides, &quantEncoding));
+    }
+    else if (m_halfOutput && i >= 2)
+    {
+      for (size_t d = 0; d < strides.size(); d++)
+      {
+        strides[d] = strides[d] / sizeof(float) * sizeof(uint16_t);
+      }
+
+      zdl::DlSystem::UserBufferEncodingFloatN halfEncoding(16);
+      m_userBuffers.push_back(ubFactory.createUserBuffer(
+        halfBuffList[i], stride / sizeof(float) * sizeof(uint16_t), strides, &halfEncoding));
+    }
+    else
+    {
+      m_userBuffers.push_back(ubFactory.createUserBuffer(buffList[i], stride, strides, &outputEncoding));
+    }
+    m_outputBufferMap.add(name, m_userBuffers.back().get());
+  }
+
+  return true;
+}
+
+
+bool YOLOADAS::_getOutputQuantization(const std::string &name, QuantParams &params)
+{
+  auto bufferAttributesOpt = m_snpe->getInputOutputBufferAttributes(name.c_str());
+  if (!bufferAttributesOpt)
+    return false;
+
+  const zdl::DlSystem::UserBufferEncoding *encoding = (*bufferAttributesOpt)->getEncoding();
+  if (encoding == nullptr ||
+      encoding->getElementType() != zdl::DlSystem::UserBufferEncoding::ElementType_t::TF8)
+    return false;
+
+  const zdl::DlSystem::UserBufferEncodingTf8 *tf8 =
+    dynamic_cast<const zdl::DlSystem::UserBufferEncodingTf8 *>(encoding);
+  if (tf8 == nullptr)
+    return false;
+
+  params.zeroPoint = (int)tf8->getStepExactly0();
+  params.step = tf8->getQuantizedStepSize();
+
+  return params.step > 0.0f;
+}
+
+
+bool YOLOADAS::_commitInput()
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  // The user buffer is the network input itself
+  if (m_useUserBuffers)
+    return true;
+
+  if (m_inputTensor->getSize() != m_inputBuff.size())
+  {
+    m_logger->error("Size of input does not match network.");
+    m_logger->error("Expecting: {}", m_inputTensor->getSize());
+    m_logger->error("Got: {}", m_inputBuff.size());
+
+    return false;
+  }
 
-  m_laneBuff = new float [SEG_WIDTH*SEG_HEIGHT];
-  m_lineBuff = new float [SEG_WIDTH*SEG_HEIGHT];
+  /* Copy the loaded input file contents into the networks input tensor.
+    SNPE's ITensor supports C++ STL functions like std::copy() */
+  std::copy(m_inputBuff.begin(), m_inputBuff.end(), m_inputTensor->begin());
 
   return true;
 }
 
 
+bool YOLOADAS::_execute()
+{
+  if (m_useUserBuffers)
+  {
+    m_inference = m_snpe->execute(m_inputBufferMap, m_outputBufferMap);
+  }
+  else
+  {
+    m_inference = m_snpe->execute(m_inputTensor.get(), m_outputTensorMap);
+  }
+
+  return m_inference;
+}
+
+
 bool YOLOADAS::_getITensor(float *yoloOutputBuff, const zdl::DlSystem::ITensor* tensor)
 {
   int batchChunk = tensor->getSize();
@@ -294,299 +669,1157 @@ bool YOLOADAS::_getITensor(float *yoloOutputBuff, const zdl::DlSystem::ITensor*
 }
 
 
-bool YOLOADAS::_getOutputTensor()
+bool YOLOADAS::_getOutputTensor()
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  float *buffList[5];
+  int sizeList[5];
+  int numBuff = _getOutputBuffers(buffList, sizeList);
+
+  for (int i = 0; i < numBuff; i++)
+  {
+    auto tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[i].c_str());
+    if (tensorPtr == nullptr || (int)tensorPtr->getSize() != sizeList[i] || !_getITensor(buffList[i], tensorPtr))
+    {
+      m_logger->error("Failed to get {} tensor", m_outputTensorList[i]);
+      return false;
+    }
+  }
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Get Output]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+  return true;
+}
+
+
+int YOLOADAS::_getOutputBuffers(float **buffList, int *sizeList)
+{
+  // Same order as m_outputTensorList
+  buffList[0] = m_lineBuff;
+  buffList[1] = m_laneBuff;
+  sizeList[0] = m_modelShape.segSize();
+  sizeList[1] = m_modelShape.segSize();
+
+  if (m_rawHead)
+  {
+    buffList[2] = m_detectionRawBuff;
+    sizeList[2] = m_detectionRawSize;
+    return 3;
+  }
+
+  buffList[2] = m_detectionBoxBuff;
+  buffList[3] = m_detectionConfBuff;
+  buffList[4] = m_detectionClsBuff;
+
+  sizeList[2] = m_detectionBoxSize;
+  sizeList[3] = m_detectionConfSize;
+  sizeList[4] = m_detectionClassSize;
+
+  return 5;
+}
+
+
+void YOLOADAS::_dequantizeOutputs()
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  if (!m_quantizedOutput && !m_halfOutput)
+    return;
+
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  int numPassed;
+  if (m_quantizedOutput)
+  {
+    numPassed = m_quantFilter.run(
+      m_detectionBoxQ.data(), m_detectionConfQ.data(), m_detectionClsQ.data(), m_nmsParams.minConfThreshold(),
+      m_detectionBoxBuff, m_detectionConfBuff, m_detectionClsBuff);
+  }
+  else if (m_recorder != nullptr)
+  {
+    // Recorded outputs have to replay at any threshold, so every anchor is
+    // converted, with the vector kernels
+    halfKernel::toFloat(m_detectionBoxH.data(), m_detectionBoxBuff, m_detectionBoxSize);
+    halfKernel::toFloat(m_detectionConfH.data(), m_detectionConfBuff, m_detectionConfSize);
+    halfKernel::toFloat(m_detectionClsH.data(), m_detectionClsBuff, m_detectionClassSize);
+    numPassed = m_modelShape.numAnchors;
+  }
+  else
+  {
+    numPassed = m_quantFilter.runHalf(
+      m_detectionBoxH.data(), m_detectionConfH.data(), m_detectionClsH.data(), m_nmsParams.minConfThreshold(),
+      m_detectionBoxBuff, m_detectionConfBuff, m_detectionClsBuff);
+  }
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Dequantize]: \t{} ms, {} / {} anchors", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000),
+    numPassed, m_modelShape.numAnchors);
+}
+
+
+bool YOLOADAS::_outputsReady()
+{
+  if (!(m_laneBuff && m_lineBuff))
+    return false;
+
+  if (m_rawHead)
+    return m_rawDecoder && m_detectionRawBuff;
+
+  return m_boxDecoder && m_detectionBoxBuff && m_detectionConfBuff && m_detectionClsBuff;
+}
+
+
+// ============================================
+//            Inference Entrypoint
+// ============================================
+
+bool YOLOADAS::run()
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+  auto time_0 = std::chrono::high_resolution_clock::now();
+  _execute();
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Inference]: \t{} ms",\
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  //
+  postProcessing();
+  _runTiles();
+  _releaseNV12Frame();
+  return true;
+}
+
+
+bool YOLOADAS::run(cv::Mat &imgFrame)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  if (m_estimateTime)
+  {
+    m_logger->debug("\n[YOLO-ADAS Processing Time]");
+    m_logger->debug("-----------------------------------------");
+  }
+  // STEP1: load image to input tensor
+  if (!loadInput(imgFrame))
+  {
+    m_logger->error("Load Input Data Failed");
+
+    return false;
+  }
+
+  // STEP2: run inference
+  auto time_0 = std::chrono::high_resolution_clock::now();
+  _execute();
+
+  if (!m_inference)
+  {
+    m_logger->error("AI Inference Failed");
+
+    return false;
+  }
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Inference]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  // STEP3: post processing
+  if (!postProcessing())
+  {
+    m_logger->error("AI Post Processing Failed");
+
+    return false;
+  }
+
+  // STEP4: tiles, merged into the detections
+  if (!_runTiles())
+  {
+    m_logger->error("Tiled Inference Failed");
+
+    return false;
+  }
+
+  if (m_estimateTime)
+  {
+    m_logger->debug("-----------------------------------------");
+  }
+
+  return true;
+}
+
+bool YOLOADAS::run(
+  const uint8_t *y,
+  size_t yPitch,
+  const uint8_t *uv,
+  size_t uvPitch,
+  int width,
+  int height)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  // STEP1: load NV12 frame to input tensor
+  if (!loadInputNV12(y, yPitch, uv, uvPitch, width, height))
+  {
+    m_logger->error("Load Input Data Failed");
+    _releaseNV12Frame();
+
+    return false;
+  }
+
+  // STEP2: run inference
+  auto time_0 = std::chrono::high_resolution_clock::now();
+  _execute();
+
+  if (!m_inference)
+  {
+    m_logger->error("AI Inference Failed");
+    _releaseNV12Frame();
+
+    return false;
+  }
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Inference]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  // STEP3: post processing
+  if (!postProcessing())
+  {
+    m_logger->error("AI Post Processing Failed");
+    _releaseNV12Frame();
+
+    return false;
+  }
+
+  // STEP4: tiles, merged into the detections
+  if (!_runTiles())
+  {
+    m_logger->error("Tiled Inference Failed");
+    _releaseNV12Frame();
+
+    return false;
+  }
+
+  _releaseNV12Frame();
+
+  return true;
+}
+
+// ============================================
+//                Load Inputs
+// ============================================
+bool YOLOADAS::loadInput(std::string filePath)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  m_logger->debug("\n===================================");
+  m_logger->debug("[File] => {}", filePath);
+  m_logger->debug("===================================");
+
+  // Preprocessing
+  preProcessingFile(filePath);
+
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  if (!_commitInput())
+    return false;
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+
+  m_logger->debug("[Load Input]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  return true;
+}
+
+
+bool YOLOADAS::loadInput(cv::Mat &imgFrame)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  // Preprocessing
+  if (!preProcessingMemory(imgFrame))
+  {
+    m_logger->error("Data Preprocessing Failed");
+
+    return false;
+  }
+
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  if (!_commitInput())
+    return false;
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+
+  m_logger->debug("[Load Input]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  return true;
+}
+
+
+bool YOLOADAS::loadInputNV12(
+  const uint8_t *y,
+  size_t yPitch,
+  const uint8_t *uv,
+  size_t uvPitch,
+  int width,
+  int height)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  // The BGR frame is only made if someone asks for it, see getInputImage()
+  m_img.release();
+  m_nv12Y = y;
+  m_nv12UV = uv;
+  m_nv12YPitch = yPitch;
+  m_nv12UVPitch = uvPitch;
+  m_frameSize = cv::Size(width, height);
+  m_srcROI = _clipInputROI(m_frameSize);
+
+  // Image Enhancement, applied as a lookup in the pass below
+  _calcBrightness();
+  _updateEnhancementLUT();
+
+  if (!_preprocessRegion(m_srcROI, m_inputTransform))
+  {
+    m_logger->error("NV12 preprocessing failed, frame {}x{}", width, height);
+    return false;
+  }
+
+  if (!_commitInput())
+    return false;
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Pre-Proc NV12]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  return true;
+}
+
+
+bool YOLOADAS::getInputImage(cv::Mat &img)
+{
+  if (m_img.empty() && m_nv12Y != nullptr)
+  {
+    m_nv12Converter.convert(
+      m_nv12Y, m_nv12YPitch, m_nv12UV, m_nv12UVPitch, m_frameSize.width, m_frameSize.height, m_img);
+  }
+
+  img = m_img;
+
+  return !img.empty();
+}
+
+
+// The planes belong to the caller, they are not touched past the run
+void YOLOADAS::_releaseNV12Frame()
+{
+  m_nv12Y = nullptr;
+  m_nv12UV = nullptr;
+}
+
+
+void YOLOADAS::setLetterbox(bool enable)
+{
+  m_preprocessor->setLetterbox(enable);
+}
+
+
+LetterboxTransform YOLOADAS::getInputTransform()
+{
+  return m_inputTransform;
+}
+
+
+void YOLOADAS::setInputROI(const cv::Rect &roi)
+{
+  m_inputROI = roi;
+}
+
+
+cv::Rect YOLOADAS::getInputROI()
+{
+  return m_inputROI;
+}
+
+
+// The ROI inside the frame, falls back to the whole frame
+cv::Rect YOLOADAS::_clipInputROI(cv::Size frameSize)
+{
+  cv::Rect roi = _clipRect(m_inputROI, frameSize);
+  if (roi.empty())
+    return cv::Rect(0, 0, frameSize.width, frameSize.height);
+
+  return roi;
+}
+
+
+// Rect inside the frame, on even coordinates so that it also splits the
+// NV12 chroma plane cleanly. Empty if nothing usable is left.
+cv::Rect YOLOADAS::_clipRect(const cv::Rect &rect, cv::Size frameSize)
+{
+  cv::Rect clipped = rect & cv::Rect(0, 0, frameSize.width, frameSize.height);
+  int x1 = (clipped.x + clipped.width) & ~1;
+  int y1 = (clipped.y + clipped.height) & ~1;
+  clipped.x &= ~1;
+  clipped.y &= ~1;
+  clipped.width = x1 - clipped.x;
+  clipped.height = y1 - clipped.y;
+
+  if (clipped.width < 2 || clipped.height < 2)
+    return cv::Rect();
+
+  return clipped;
+}
+
+
+bool YOLOADAS::setTiles(const vector<cv::Rect> &tiles)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  // Only the full frame outputs are recorded, a replay couldn't merge the tiles
+  if (!tiles.empty() && m_recorder != nullptr)
+  {
+    m_logger->error("Tiled inference can't be recorded, stop the recording first");
+    return false;
+  }
+
+  m_tiles = tiles;
+  return true;
+}
+
+
+vector<cv::Rect> YOLOADAS::getTiles()
+{
+  return m_tiles;
+}
+
+
+void YOLOADAS::setNmsMethod(NmsMethod method)
+{
+  m_nmsMethod = method;
+}
+
+
+NmsMethod YOLOADAS::getNmsMethod()
+{
+  return m_nmsMethod;
+}
+
+
+int YOLOADAS::getDetectionCapacity()
+{
+  return m_yoloOut.capacity();
+}
+
+
+int YOLOADAS::getDetectionOverflow()
+{
+  return m_yoloOut.getLastOverflow();
+}
+
+
+uint64_t YOLOADAS::getTotalDetectionOverflow()
+{
+  return m_yoloOut.getTotalOverflow();
+}
+
+
+void YOLOADAS::setMaxCandidates(int maxCandidates)
+{
+  if (m_rawDecoder)
+    m_rawDecoder->setMaxCandidates(maxCandidates);
+  if (m_boxDecoder)
+    m_boxDecoder->setMaxCandidates(maxCandidates);
+}
+
+
+int YOLOADAS::getMaxCandidates()
+{
+  if (m_rawDecoder)
+    return m_rawDecoder->getMaxCandidates();
+  if (m_boxDecoder)
+    return m_boxDecoder->getMaxCandidates();
+
+  return 0;
+}
+
+
+void YOLOADAS::setClassNmsParams(int classId, const ClassNmsParams &params)
+{
+  if (classId < 0)
+    return;
+
+  if (classId >= (int)m_nmsParams.classes.size())
+    m_nmsParams.classes.resize(classId + 1, m_nmsParams.defaults);
+
+  m_nmsParams.classes[classId] = params;
+}
+
+
+ClassNmsParams YOLOADAS::getClassNmsParams(int classId)
+{
+  return m_nmsParams.get(classId);
+}
+
+
+vector<cv::Rect> YOLOADAS::makeBandTiles(cv::Size frameSize, int centerY, cv::Size tileSize, int count)
+{
+  vector<cv::Rect> tiles;
+  if (count <= 0)
+    return tiles;
+
+  int tileW = std::min(tileSize.width, frameSize.width);
+  int tileH = std::min(tileSize.height, frameSize.height);
+  int y = std::min(std::max(centerY - tileH / 2, 0), frameSize.height - tileH);
+
+  for (int i = 0; i < count; i++)
+  {
+    int x = count == 1 ?
+      (frameSize.width - tileW) / 2 :
+      (int)((float)i * (frameSize.width - tileW) / (count - 1) + 0.5f);
+    tiles.push_back(cv::Rect(x, y, tileW, tileH));
+  }
+
+  return tiles;
+}
+
+
+static std::string _dirName(const std::string &filePath)
+{
+  size_t pos = filePath.find_last_of('/');
+  return pos == std::string::npos ? "." : filePath.substr(0, pos);
+}
+
+
+// Files are loaded by directory, the images that follow the requested one
+// are decoded ahead on the pool
+bool YOLOADAS::_startPrefetch(const std::string& inputFile)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  delete m_prefetcher;
+  m_prefetcher = nullptr;
+
+  std::string dir = _dirName(inputFile);
+  m_prefetchDir = dir;
+
+  // glob returns the names sorted
+  vector<cv::String> names;
+  cv::glob(dir + "/*", names, false);
+
+  // Named like inputFile, pop() matches the paths as given
+  std::string prefix = inputFile.substr(0, inputFile.find_last_of('/') + 1);
+  vector<std::string> fileList;
+  bool found = false;
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    std::string name = prefix + std::string(names[i]).substr(names[i].find_last_of('/') + 1);
+    std::string ext = name.substr(name.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext != "jpg" && ext != "jpeg" && ext != "png" && ext != "bmp")
+      continue;
+
+    found = found || name == inputFile;
+    if (found)
+      fileList.push_back(name);
+  }
+  if (fileList.size() < 2)
+    return false;
+
+  m_prefetcher = new ImagePrefetcher(fileList, m_prefetchWorkers, m_prefetchLookAhead, _prefetchResizeTo());
+
+  m_logger->info("Prefetch {} files of {} on {} workers, look-ahead {}",
+    fileList.size(), dir, m_prefetchWorkers, m_prefetchLookAhead);
+
+  return true;
+}
+
+
+// Pre-resized images skip the resize in _imgPreprocessing, letterbox and
+// ROI need the original frame though
+cv::Size YOLOADAS::_prefetchResizeTo()
+{
+  if (!m_prefetchPreResize || m_preprocessor->isLetterbox() || !m_inputROI.empty())
+    return cv::Size();
+
+  return cv::Size(m_inputWidth, m_inputHeight);
+}
+
+
+bool YOLOADAS::_loadImageFile(const std::string& inputFile)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  // A file of another directory starts the prefetch over
+  if (m_prefetchWorkers > 0 && _dirName(inputFile) != m_prefetchDir)
+    _startPrefetch(inputFile);
+
+  if (m_prefetcher != nullptr)
+  {
+    // Letterbox or ROI may have been set since the prefetch started
+    m_prefetcher->setResizeTo(_prefetchResizeTo());
+    m_prefetcher->pop(inputFile, m_img);
+  }
+  else
+  {
+    m_img = cv::imread(inputFile, -1);
+  }
+  if (m_img.empty())
+  {
+    m_logger->error("image don't exist!");
+    return false;
+  }
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Read Image]: \t{} ms", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  if (m_prefetcher != nullptr)
+  {
+    float decodeMs, waitMs, busyMs;
+    int count;
+    m_prefetcher->getStats(decodeMs, waitMs, busyMs, count);
+    if (count >= m_prefetchLogInterval)
+    {
+      // Waiting on the pool means decode, not inference, sets the pace
+      m_logger->info("[Prefetch] decode {:.2f} ms/img on {} workers, wait {:.2f} ms/img, busy {:.2f} ms/img => {}",
+        decodeMs, m_prefetchWorkers, waitMs, busyMs,
+        waitMs > 0.1 * busyMs ? "decoder-bound" : "inference-bound");
+      m_prefetcher->resetStats();
+    }
+  }
+
+  return true;
+}
+
+// ============================================
+//               Pre Processing
+// ============================================
+bool YOLOADAS::preProcessingFile(std::string imgPath)
+{
+  _loadImageFile(imgPath);
+  _imgPreprocessing();
+  return true;
+}
+
+
+bool YOLOADAS::preProcessingMemory(cv::Mat &imgFrame)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  if (imgFrame.empty())
+  {
+    m_logger->error("Image don't exists!");
+    return false;
+  }
+  else
+  {
+    m_img = imgFrame;
+  }
+  _imgPreprocessing();
+  return true;
+}
+
+
+bool YOLOADAS::_imgPreprocessing()
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+  auto time_0 = std::chrono::high_resolution_clock::now();
+
+  m_frameSize = m_img.size();
+  m_srcROI = _clipInputROI(m_frameSize);
+  m_nv12Y = nullptr;
+  m_nv12UV = nullptr;
+
+  // Image Enhancement, applied as a lookup in the pass below
+  _calcBrightness();
+  _updateEnhancementLUT();
+
+  if (!_preprocessRegion(m_srcROI, m_inputTransform))
+  {
+    m_logger->error("Preprocessing failed, image {}x{} type {}", m_img.cols, m_img.rows, m_img.type());
+    return false;
+  }
+
+  auto time_1 = std::chrono::high_resolution_clock::now();
+  m_logger->debug("[Pre-Proc]: \t{}",\
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+
+  return true;
+}
+
+
+// Resize, enhancement, color conversion and normalization of one region
+// of the current frame into the input buffer, in one pass. The region is a
+// view on the frame (BGR) or an offset into the planes (NV12), nothing is
+// copied. tf maps frame to network input coordinates.
+bool YOLOADAS::_preprocessRegion(const cv::Rect &rect, LetterboxTransform &tf)
+{
+  bool ok;
+
+  if (m_nv12Y != nullptr && !m_enhanceViaLUT)
+  {
+    // The enhancement can't be folded into the pass, convert and enhance
+    // the region first
+    cv::Mat img;
+    m_nv12Converter.convert(
+      m_nv12Y + rect.y * m_nv12YPitch + rect.x, m_nv12YPitch,
+      m_nv12UV + (rect.y / 2) * m_nv12UVPitch + rect.x, m_nv12UVPitch,
+      rect.width, rect.height, img);
+    imgUtil::brightnessEnhancement(m_brightness, img);
+    ok = m_inputU8 ?
+      m_preprocessor->runBGR(img, &m_inputBuffU8[0]) :
+      m_preprocessor->runBGR(img, &m_inputBuff[0]);
+  }
+  else if (m_nv12Y != nullptr)
+  {
+    const uint8_t *y = m_nv12Y + rect.y * m_nv12YPitch + rect.x;
+    const uint8_t *uv = m_nv12UV + (rect.y / 2) * m_nv12UVPitch + rect.x;
+    ok = m_inputU8 ?
+      m_preprocessor->runNV12(y, m_nv12YPitch, uv, m_nv12UVPitch, rect.width, rect.height, &m_inputBuffU8[0]) :
+      m_preprocessor->runNV12(y, m_nv12YPitch, uv, m_nv12UVPitch, rect.width, rect.height, &m_inputBuff[0]);
+  }
+  else
+  {
+    cv::Mat img = m_img(rect);
+    if (!m_enhanceViaLUT)
+    {
+      img = img.clone();
+      imgUtil::brightnessEnhancement(m_brightness, img);
+    }
+    ok = m_inputU8 ?
+      m_preprocessor->runBGR(img, &m_inputBuffU8[0]) :
+      m_preprocessor->runBGR(img, &m_inputBuff[0]);
+  }
+
+  if (!ok)
+    return false;
+
+  tf = m_preprocessor->getTransform();
+  tf.offsetX = (float)rect.x;
+  tf.offsetY = (float)rect.y;
+
+  return true;
+}
+
+
+void YOLOADAS::_calcBrightness()
+{
+  // Every other frame, on a sparse sample of the input region
+  if (m_calcBrightnessCounter == 0)
+  {
+    cv::Size sampleSize(
+      std::max(1, m_srcROI.width / BRIGHTNESS_SAMPLE_STEP),
+      std::max(1, m_srcROI.height / BRIGHTNESS_SAMPLE_STEP));
+
+    if (m_nv12Y != nullptr)
+    {
+      m_sampleConverter.convert(
+        m_nv12Y + m_srcROI.y * m_nv12YPitch + m_srcROI.x, m_nv12YPitch,
+        m_nv12UV + (m_srcROI.y / 2) * m_nv12UVPitch + m_srcROI.x, m_nv12UVPitch,
+        m_srcROI.width, m_srcROI.height, m_brightnessSample, sampleSize);
+    }
+    else
+    {
+      cv::resize(m_img(m_srcROI), m_brightnessSample, sampleSize, 0, 0, cv::INTER_NEAREST);
+    }
+
+    m_brightness = imgUtil::calcBrightnessRatio(m_brightnessSample);
+    m_calcBrightnessCounter += 1;
+  }
+  else
+  {
+    m_calcBrightnessCounter = 0;
+  }
+}
+
+
+void YOLOADAS::_updateEnhancementLUT()
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
-  auto time_0 = std::chrono::high_resolution_clock::now();
-
-  auto lane_tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[0].c_str());
-  auto drive_tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[1].c_str());
-  // auto detection_tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[2].c_str());
-  auto detectionBox_tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[2].c_str());
-  auto detectionConf_tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[3].c_str());
-  auto detectionCls_tensorPtr = m_outputTensorMap.getTensor(m_outputTensorList[4].c_str());
 
-  if(!_getITensor(m_lineBuff, lane_tensorPtr))
+  if (!m_enhanceViaLUT || (m_enhanceLUTValid &&
+      std::fabs(m_brightness - m_enhanceLUTBrightness) <= ENHANCE_LUT_TOLERANCE * std::fabs(m_enhanceLUTBrightness)))
   {
-    m_logger->error("Failed to get lane line tensor");
-    return false;
-  }
-
-  if(!_getITensor(m_laneBuff, drive_tensorPtr))
-  {
-    m_logger->error("Failed to get drivable area tensor");
-    return false;
+    return;
   }
 
-  if(!_getITensor(m_detectionBoxBuff, detectionBox_tensorPtr))
+  // The enhancement works per pixel value, so running it once over all 256
+  // levels gives the curve the preprocessing pass applies as a lookup
+  cv::Mat ramp(1, 256, CV_8UC3);
+  uint8_t *p = ramp.ptr<uint8_t>(0);
+  for (int i = 0; i < 256; i++)
   {
-    m_logger->error("Failed to get detection box tensor");
-    return false;
+    p[3 * i] = p[3 * i + 1] = p[3 * i + 2] = (uint8_t)i;
   }
+  imgUtil::brightnessEnhancement(m_brightness, ramp);
 
-  if(!_getITensor(m_detectionConfBuff, detectionConf_tensorPtr))
+  // The LUT is only right if the enhancement is a per-pixel-value curve:
+  // check it against the direct path on the brightness sample, and apply
+  // the enhancement directly from now on if it isn't
+  if (m_brightnessSample.type() == CV_8UC3 && !m_brightnessSample.empty())
   {
-    m_logger->error("Failed to get detection conf tensor");
-    return false;
-  }
+    cv::Mat direct = m_brightnessSample.clone();
+    cv::Mat viaLUT;
+    imgUtil::brightnessEnhancement(m_brightness, direct);
+    cv::LUT(m_brightnessSample, ramp, viaLUT);
 
-  if(!_getITensor(m_detectionClsBuff, detectionCls_tensorPtr))
-  {
-    m_logger->error("Failed to get detection cls tensor");
-    return false;
+    double maxDiff = cv::norm(direct, viaLUT, cv::NORM_INF);
+    if (maxDiff > ENHANCE_LUT_MAX_DIFF)
+    {
+      m_logger->warn("Enhancement LUT differs from the direct enhancement by {} levels, applying it directly", maxDiff);
+      m_enhanceViaLUT = false;
+      m_preprocessor->setEnhancementLUT(cv::Mat());
+      return;
+    }
   }
+  m_preprocessor->setEnhancementLUT(ramp);
 
-  auto time_1 = std::chrono::high_resolution_clock::now();
-  m_logger->debug("[Get Output]: \t{} ms", \
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
-  return true;
+  m_enhanceLUTBrightness = m_brightness;
+  m_enhanceLUTValid = true;
+  m_logger->debug("Enhancement LUT updated, brightness = {}", m_brightness);
 }
 
-
 // ============================================
-//            Inference Entrypoint
+//               Record & Replay
 // ============================================
-
-bool YOLOADAS::run()
+bool YOLOADAS::startRecording(const std::string &filePath, bool compress)
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
-  auto time_0 = std::chrono::high_resolution_clock::now();
-  m_inference = m_snpe->execute(m_inputTensor.get(), m_outputTensorMap);
-  auto time_1 = std::chrono::high_resolution_clock::now();
-  m_logger->debug("[Inference]: \t{} ms",\
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
 
-  //
-  postProcessing();
+  // Only the full frame outputs are recorded, a replay couldn't merge the tiles
+  if (!m_tiles.empty())
+  {
+    m_logger->error("Tiled inference can't be recorded, clear the tiles first");
+    return false;
+  }
+
+  stopRecording();
+  m_recorder = new TensorRecordWriter(filePath, compress);
+  m_recordSeq = 0;
+
+  m_logger->info("Record output tensors to {}{}", filePath, compress ? " (compressed)" : "");
+
   return true;
 }
 
 
-bool YOLOADAS::run(cv::Mat &imgFrame)
+void YOLOADAS::stopRecording()
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
 
-  if (m_estimateTime)
+  if (m_recorder == nullptr)
+    return;
+
+  if (!m_recorder->close())
   {
-    m_logger->debug("\n[YOLO-ADAS Processing Time]");
-    m_logger->debug("-----------------------------------------");
+    m_logger->error("Failed to write the output record");
   }
-  // STEP1: load image to input tensor
-  if (!loadInput(imgFrame))
-  {
-    m_logger->error("Load Input Data Failed");
+  m_logger->info("[Record] {} frames, {:.1f} MB of outputs in {:.1f} MB",
+    m_recorder->getFrameCount(),
+    m_recorder->getRawBytes() / (1024.0 * 1024),
+    m_recorder->getStoredBytes() / (1024.0 * 1024));
 
-    return false;
-  }
+  delete m_recorder;
+  m_recorder = nullptr;
+}
 
-  // STEP2: run inference
-  auto time_0 = std::chrono::high_resolution_clock::now();
-  m_inference = m_snpe->execute(m_inputTensor.get(), m_outputTensorMap);
 
-  if (!m_inference)
-  {
-    m_logger->error("AI Inference Failed");
+bool YOLOADAS::replay(
+  const std::string &filePath,
+  bool paced,
+  std::function<void(const RecordedFrame &)> onFrame)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
 
+  TensorRecordReader reader;
+  if (!reader.open(filePath))
+  {
+    m_logger->error("Failed to open output record {}", filePath);
     return false;
   }
 
-  auto time_1 = std::chrono::high_resolution_clock::now();
-  m_logger->debug("[Inference]: \t{} ms", \
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+  RecordedFrame frame;
+  int frameCount = 0;
+  double procMs = 0;
+  int64_t firstTimestampUs = 0;
+  auto time_start = std::chrono::steady_clock::now();
 
-  // STEP3: post processing
-  if (!postProcessing())
+  while (reader.next(frame))
   {
-    m_logger->error("AI Post Processing Failed");
+    // Recorded pacing: hold each frame until its offset from the first one
+    if (paced)
+    {
+      if (frameCount == 0)
+      {
+        firstTimestampUs = frame.header.timestampUs;
+        time_start = std::chrono::steady_clock::now();
+      }
+      else
+      {
+        std::this_thread::sleep_until(
+          time_start + std::chrono::microseconds(frame.header.timestampUs - firstTimestampUs));
+      }
+    }
 
-    return false;
+    auto time_0 = std::chrono::high_resolution_clock::now();
+    if (!postProcessing(frame))
+      return false;
+    auto time_1 = std::chrono::high_resolution_clock::now();
+    procMs += std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000);
+
+    if (onFrame)
+      onFrame(frame);
+
+    frameCount++;
   }
 
-  if (m_estimateTime)
+  if (frameCount == 0)
   {
-    m_logger->debug("-----------------------------------------");
+    m_logger->error("No frame in output record {}", filePath);
+    return false;
   }
 
+  m_logger->info("[Replay] {} frames, post-processing {:.2f} ms/frame => {:.1f} fps",
+    frameCount, procMs / frameCount, procMs > 0 ? 1000.0 * frameCount / procMs : 0);
+
   return true;
 }
 
-// ============================================
-//                Load Inputs
-// ============================================
-bool YOLOADAS::loadInput(std::string filePath)
+
+bool YOLOADAS::replayFrames(
+  const std::string &filePath,
+  bool paced,
+  std::function<void(uint64_t frameIdx, int64_t timestampUs)> onFrame)
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
 
-  m_logger->debug("\n===================================");
-  m_logger->debug("[File] => {}", filePath);
-  m_logger->debug("===================================");
-
-  // Preprocessing
-  preProcessingFile(filePath);
+  FrameDatasetReader reader;
+  if (!reader.open(filePath))
+  {
+    m_logger->error("Failed to open frame dataset {}", filePath);
+    return false;
+  }
+  if (reader.getFrameCount() == 0)
+  {
+    m_logger->error("No frame in frame dataset {}", filePath);
+    return false;
+  }
 
-  auto time_0 = std::chrono::high_resolution_clock::now();
+  uint64_t frameCount = reader.getFrameCount();
+  double runMs = 0;
+  int64_t firstTimestampUs = reader.getTimestamp(0);
+  auto time_start = std::chrono::steady_clock::now();
 
-  if (m_inputTensor->getSize() != m_inputBuff.size())
+  for (uint64_t i = 0; i < frameCount; i++)
   {
-    m_logger->error("Size of input does not match network.");
-    m_logger->error("Expecting: {}", m_inputTensor->getSize());
-    m_logger->error("Got: {}", m_inputBuff.size());
+    // View into the private mapping, preprocessing in place only copies
+    // the pages it touches
+    cv::Mat frame;
+    if (!reader.getFrame(i, frame))
+      return false;
+    if (reader.getPixelFormat() == PIXFMT_GRAY8)
+    {
+      cv::Mat bgr;
+      cv::cvtColor(frame, bgr, cv::COLOR_GRAY2BGR);
+      frame = bgr;
+    }
 
-    return false;
-  }
+    // Recorded pacing, frames without a capture time are run back to back
+    int64_t timestampUs = reader.getTimestamp(i);
+    if (paced && firstTimestampUs >= 0 && timestampUs >= firstTimestampUs)
+    {
+      std::this_thread::sleep_until(
+        time_start + std::chrono::microseconds(timestampUs - firstTimestampUs));
+    }
 
-  /* Copy the loaded input file contents into the networks input tensor.
-    SNPE's ITensor supports C++ STL functions like std::copy() */
-  std::copy(m_inputBuff.begin(), m_inputBuff.end(), m_inputTensor->begin());
+    auto time_0 = std::chrono::high_resolution_clock::now();
+    if (!run(frame))
+      return false;
+    auto time_1 = std::chrono::high_resolution_clock::now();
+    runMs += std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000);
 
-  auto time_1 = std::chrono::high_resolution_clock::now();
+    if (onFrame)
+      onFrame(i, timestampUs);
+  }
 
-  m_logger->debug("[Load Input]: \t{} ms", \
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+  m_logger->info("[Replay] {} frames, run {:.2f} ms/frame => {:.1f} fps",
+    frameCount, runMs / frameCount, runMs > 0 ? 1000.0 * frameCount / runMs : 0);
 
   return true;
 }
 
 
-bool YOLOADAS::loadInput(cv::Mat &imgFrame)
+bool YOLOADAS::_recordOutputTensor()
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
+  float *buffList[5];
+  int sizeList[5];
 
-  // Preprocessing
-  if (!preProcessingMemory(imgFrame))
-  {
-    m_logger->error("Data Preprocessing Failed");
+  int64_t timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+  uint32_t inputShape[4] = {
+    1, (uint32_t)m_frameSize.height, (uint32_t)m_frameSize.width, 3};
 
-    return false;
+  bool ret = m_recorder->beginFrame(m_recordSeq++, timestampUs, inputShape);
+  int numBuff = _getOutputBuffers(buffList, sizeList);
+  for (int i = 0; i < numBuff && ret; i++)
+  {
+    uint32_t shape[4] = {1, (uint32_t)sizeList[i], 1, 1};
+    ret = m_recorder->addTensor(
+      m_outputTensorList[i], 0, shape, sizeof(float), buffList[i], sizeList[i] * sizeof(float));
   }
+  ret = ret && m_recorder->endFrame();
 
-  auto time_0 = std::chrono::high_resolution_clock::now();
-
-  if (m_inputTensor->getSize() != m_inputBuff.size())
+  if (!ret)
   {
-    m_logger->error("Size of input does not match network.");
-    m_logger->error("Expecting: {}", m_inputTensor->getSize());
-    m_logger->error("Got: {}", m_inputBuff.size());
-
-    return false;
+    m_logger->error("Failed to record output tensors, recording is stopped");
+    stopRecording();
   }
 
-  /* Copy the loaded input file contents into the networks input tensor.
-    SNPE's ITensor supports C++ STL functions like std::copy() */
-  std::copy(m_inputBuff.begin(), m_inputBuff.end(), m_inputTensor->begin());
-
-  auto time_1 = std::chrono::high_resolution_clock::now();
-
-  m_logger->debug("[Load Input]: \t{} ms", \
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
-
-  return true;
+  return ret;
 }
 
 
-bool YOLOADAS::_loadImageFile(const std::string& inputFile)
+bool YOLOADAS::_loadRecordedTensor(const RecordedFrame &frame)
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
-  auto time_0 = std::chrono::high_resolution_clock::now();
+  float *buffList[5];
+  int sizeList[5];
 
-  m_img = cv::imread(inputFile, -1);
-  if (m_img.empty())
+  int numBuff = _getOutputBuffers(buffList, sizeList);
+  for (int i = 0; i < numBuff; i++)
   {
-    m_logger->error("image don't exist!");
-    return false;
+    const RecordedTensor *tensor = frame.find(m_outputTensorList[i]);
+    if (tensor == nullptr || tensor->desc.size != sizeList[i] * sizeof(float))
+    {
+      m_logger->error("Recorded tensor {} doesn't match the model", m_outputTensorList[i]);
+      return false;
+    }
+    std::memcpy(buffList[i], tensor->data, tensor->desc.size);
   }
 
-  auto time_1 = std::chrono::high_resolution_clock::now();
-  m_logger->debug("[Read Image]: \t{} ms", \
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
-
   return true;
 }
 
 // ============================================
-//               Pre Processing
+//              Tiled Inference
 // ============================================
-bool YOLOADAS::preProcessingFile(std::string imgPath)
-{
-  _loadImageFile(imgPath);
-  _imgPreprocessing();
-  return true;
-}
 
 
-bool YOLOADAS::preProcessingMemory(cv::Mat &imgFrame)
+bool YOLOADAS::_runTiles()
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
 
-  if (imgFrame.empty())
-  {
-    m_logger->error("Image don't exists!");
-    return false;
-  }
-  else
-  {
-    m_img = imgFrame;
-  }
-  _imgPreprocessing();
-  return true;
-}
+  if (m_tiles.empty() || !m_inference)
+    return true;
 
+  auto time_0 = std::chrono::high_resolution_clock::now();
 
-bool YOLOADAS::_imgPreprocessing()
-{
-  auto m_logger = spdlog::get("YOLO-ADAS");
+  // The full frame candidates take part in the merge as well, before their
+  // NMS and capacity cut, so that the frame goes through a single assign
+  std::vector<struct v8xyxy> candidates(m_candidates);
+
+  // The tiles run through the same output buffers. The segmentation outputs
+  // of the full frame are put back afterwards, so that they stay the ones
+  // of the frame whatever the tiles do.
+  int segSize = m_modelShape.segSize();
+  m_tileSegSave.resize(2 * segSize);
+  std::memcpy(m_tileSegSave.data(), m_lineBuff, segSize * sizeof(float));
+  std::memcpy(m_tileSegSave.data() + segSize, m_laneBuff, segSize * sizeof(float));
+
+  // The DLC has a batch size of 1, so tiles go through one after another.
+  // The image enhancement of the full frame is kept for the tiles.
+  bool ret = true;
+  int numTiles = 0;
+  for (const cv::Rect &tile : m_tiles)
+  {
+    cv::Rect rect = _clipRect(tile, m_frameSize);
+    if (rect.empty())
+      continue;
 
-  int imageSize = m_inputChannel*m_inputHeight*m_inputWidth;
-  cv::Size inputSize = cv::Size(m_inputWidth, m_inputHeight);
-  cv::Mat imgResized;
-  cv::Mat sample;
-  cv::Mat sampleNorm;
+    LetterboxTransform tileTransform;
+    if (!_preprocessRegion(rect, tileTransform) || !_commitInput())
+    {
+      m_logger->error("Tile ({}, {}, {}, {}) preprocessing failed", rect.x, rect.y, rect.width, rect.height);
+      ret = false;
+      break;
+    }
 
-  auto time_0 = std::chrono::high_resolution_clock::now();
+    if (!_execute())
+    {
+      m_logger->error("Tile ({}, {}, {}, {}) inference failed", rect.x, rect.y, rect.width, rect.height);
+      ret = false;
+      break;
+    }
 
-  if (m_img.size() != inputSize)
-  {
-    cv::resize(m_img, imgResized, inputSize, cv::INTER_LINEAR);
-  }
-  else
-  {
-    imgResized = m_img;
-  }
-  m_imgResized = imgResized;
+    if (!m_useUserBuffers && !_getOutputTensor())
+    {
+      m_logger->error("Unable to get output tensors!");
+      ret = false;
+      break;
+    }
+    _dequantizeOutputs();
 
-  // Calc brightness
-  if (m_calcBrightnessCounter == 0)
-  {
-    m_brightness = imgUtil::calcBrightnessRatio(imgResized);
-    m_calcBrightnessCounter += 1;
-  }
-  else if (m_calcBrightnessCounter >= 1)
-  {
-    m_calcBrightnessCounter = 0;
-  }
-  else
-  {
-    m_calcBrightnessCounter += 1;
-  }
+    // Tile candidates go into the merge as they are, a single NMS for all
+    _decodeCandidates(m_tileCandidates);
 
-  // Image Enhancement
-  imgUtil::brightnessEnhancement(m_brightness, m_imgResized);
+    // Tile input -> frame -> full frame input coordinates, rounded to the
+    // nearest pixel rather than truncated, which would shift every tile box
+    // up and left by up to a pixel of the full frame input
+    for (struct v8xyxy b : m_tileCandidates)
+    {
+      b.x1 = (int)std::lround(m_inputTransform.forwardX(tileTransform.inverseX((float)b.x1)));
+      b.y1 = (int)std::lround(m_inputTransform.forwardY(tileTransform.inverseY((float)b.y1)));
+      b.x2 = (int)std::lround(m_inputTransform.forwardX(tileTransform.inverseX((float)b.x2)));
+      b.y2 = (int)std::lround(m_inputTransform.forwardY(tileTransform.inverseY((float)b.y2)));
+      candidates.push_back(b);
+    }
+    numTiles++;
+  }
 
-  // BGR to RGB
-  cv::cvtColor(imgResized, sample, cv::COLOR_BGR2RGB);
+  std::memcpy(m_lineBuff, m_tileSegSave.data(), segSize * sizeof(float));
+  std::memcpy(m_laneBuff, m_tileSegSave.data() + segSize, segSize * sizeof(float));
 
-  // Normalize
-  sample.convertTo(sampleNorm, CV_32F, 1.0 / 255, 0);
+  if (!ret)
+    return false;
 
-  std::memcpy(&m_inputBuff[0], sampleNorm.data, imageSize*sizeof(float));
+  m_numBox = _mergeDetections(candidates, m_yoloOut, true);
 
   auto time_1 = std::chrono::high_resolution_clock::now();
-  m_logger->debug("[Pre-Proc]: \t{}",\
-    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
+  m_logger->debug("[Tiles]: \t{} ms, {} tiles, {} boxes, {} over capacity", \
+    std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000),
+    numTiles, m_numBox, m_yoloOut.getLastOverflow());
 
   return true;
 }
 
+
+// Class-aware NMS over the full frame and tile detections (or the raw head
+// candidates), highest confidence first. Kept boxes past the capacity of
+// out are dropped from the lowest score up.
+int YOLOADAS::_mergeDetections(std::vector<struct v8xyxy> &boxes, DetectionBuffer &out, bool countOverflow)
+{
+  m_nmsOut.resize(boxes.size());
+
+  int numKept = 0;
+  if (m_nmsMethod == NMS_GRID)
+    numKept = m_gridNms.run(boxes, m_nmsParams, m_nmsOut.data(), (int)boxes.size());
+  else
+    numKept = boxNms::pairwise(boxes, m_nmsParams, m_nmsOut.data(), (int)boxes.size());
+
+  int dropped = countOverflow ? m_droppedCandidates : 0;
+  return out.assign(m_nmsOut.data(), numKept, true, countOverflow, dropped);
+}
+
 // ============================================
 //               Post Processing
 // ============================================
@@ -596,11 +1829,13 @@ bool YOLOADAS::postProcessing()
 
   if (m_inference == true)
   {
-    if(!_getOutputTensor())
+    // With user buffers the outputs are already in place
+    if (!m_useUserBuffers && !_getOutputTensor())
     {
       m_logger->error("Unable to get output tensors!");
       return false;
     }
+    _dequantizeOutputs();
   }
   else
   {
@@ -608,11 +1843,36 @@ bool YOLOADAS::postProcessing()
     return false;
   }
 
+  if (m_recorder != nullptr)
+  {
+    _recordOutputTensor();
+  }
+
+  // STEP1: Semantic Segmentation
+  _SEG_postProcessing();
+
+  // STEP2: Object Detection
+  _OD_postProcessing(!m_tiles.empty());
+
+  return true;
+}
+
+
+bool YOLOADAS::postProcessing(const RecordedFrame &frame)
+{
+  auto m_logger = spdlog::get("YOLO-ADAS");
+
+  if (!_loadRecordedTensor(frame))
+  {
+    m_logger->error("Unable to load recorded tensors of frame {}", frame.header.seq);
+    return false;
+  }
+
   // STEP1: Semantic Segmentation
   _SEG_postProcessing();
 
   // STEP2: Object Detection
-  _OD_postProcessing();
+  _OD_postProcessing(false);
 
   return true;
 }
@@ -627,30 +1887,26 @@ void YOLOADAS::_SEG_postProcessing()
 
   m_logger->debug("Starting object detection post-processing......");
 
-  m_rawLine = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_32F, cv::Scalar::all(0));
-  m_rawLane = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_32F, cv::Scalar::all(0));
-  m_laneMask = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC1, cv::Scalar::all(0));
-  m_lineMask = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC1, cv::Scalar::all(0));
-  m_mainLaneMask = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC1, cv::Scalar::all(0));
-  m_mainLineMask = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC1, cv::Scalar::all(0));
-  m_horiLineMask = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC1, cv::Scalar::all(0));
+  cv::Size segSize(m_modelShape.segWidth, m_modelShape.segHeight);
+  m_laneMask = cv::Mat(segSize, CV_8UC1);
+  m_lineMask = cv::Mat(segSize, CV_8UC1);
+  m_mainLaneMask = cv::Mat(segSize, CV_8UC1, cv::Scalar::all(0));
+  m_mainLineMask = cv::Mat(segSize, CV_8UC1, cv::Scalar::all(0));
+  m_horiLineMask = cv::Mat(segSize, CV_8UC1, cv::Scalar::all(0));
 
   if (m_debugMode)
   {
-    m_laneColor = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC3, cv::Scalar::all(0));
-    m_lineColor = cv::Mat(cv::Size(SEG_WIDTH, SEG_HEIGHT), CV_8UC3, cv::Scalar::all(0));
+    m_laneColor = cv::Mat(segSize, CV_8UC3, cv::Scalar::all(0));
+    m_lineColor = cv::Mat(segSize, CV_8UC3, cv::Scalar::all(0));
   }
 
-  if (!(m_laneBuff && m_lineBuff && m_detectionBoxBuff && m_detectionClsBuff && m_yoloOut))  // Missing output(s)
+  if (!_outputsReady())  // Missing output(s)
   {
     m_logger->error("Not all outputs of the network are available");
   }
-  // Extract masks
-  std::memcpy(m_rawLine.data, m_lineBuff, m_rawLine.rows*m_rawLine.cols*sizeof(float));
-  std::memcpy(m_rawLane.data, m_laneBuff, m_rawLine.rows*m_rawLine.cols*sizeof(float));
-
-  m_rawLine.convertTo(m_lineMask, CV_8UC1);
-  m_rawLane.convertTo(m_laneMask, CV_8UC1);
+  // Extract masks, class ids straight from the output buffers
+  modelKernel::segToMask(m_lineBuff, m_lineMask.data, segSize.width, segSize.height);
+  modelKernel::segToMask(m_laneBuff, m_laneMask.data, segSize.width, segSize.height);
 
   if (m_debugMode)
   {
@@ -705,7 +1961,9 @@ void YOLOADAS::_SEG_postProcessing()
 }
 
 
-void YOLOADAS::_OD_postProcessing()
+// With tilesPending the detections are merged again with those of the tiles
+// right after, only that final merge counts the boxes over capacity
+void YOLOADAS::_OD_postProcessing(bool tilesPending)
 {
   auto m_logger = spdlog::get("YOLO-ADAS");
 
@@ -716,7 +1974,7 @@ void YOLOADAS::_OD_postProcessing()
   // if (!(m_laneBuff && m_lineBuff && m_detectionBuff && m_yoloOut))  // Missing output(s)
   //   cerr << "Not all outputs of the network are available" << endl;
 
-  if (!(m_laneBuff && m_lineBuff && m_detectionBoxBuff && m_detectionClsBuff && m_yoloOut))  // Missing output(s)
+  if (!_outputsReady())  // Missing output(s)
   {
     m_logger->error("Not all outputs of the network are available");
   }
@@ -724,8 +1982,9 @@ void YOLOADAS::_OD_postProcessing()
   m_logger->debug("Starting object detection post-processing......");
 
   // m_numBox = m_decoder->decode((float *)m_detectionBuff , confidenceThreshold, iouThreshold, m_yoloOut);
-  m_numBox = m_decoder->decode((
-    float *)m_detectionBoxBuff, (float *)m_detectionConfBuff, (float *)m_detectionClsBuff, confidenceThreshold, iouThreshold, m_yoloOut);
+  m_droppedCandidates = 0;
+  _decodeCandidates(m_candidates);
+  m_numBox = _mergeDetections(m_candidates, m_yoloOut, !tilesPending);
 
   // _rescaleBoundingBox(
   //   m_numBox, m_yoloOut, m_scaledOut, m_inputWidth, m_inputHeight, m_img.cols, m_img.rows);
@@ -734,6 +1993,11 @@ void YOLOADAS::_OD_postProcessing()
     std::chrono::duration_cast<std::chrono::nanoseconds>(time_1 - time_0).count() / (1000.0 * 1000));
 
   m_logger->debug("=> GET # of raw BBOX(es): {}", m_numBox);
+  if (!tilesPending && m_yoloOut.getLastOverflow() > 0)
+  {
+    m_logger->debug("=> {} BBOX(es) over capacity {} dropped, {} in total",
+      m_yoloOut.getLastOverflow(), m_yoloOut.capacity(), m_yoloOut.getTotalOverflow());
+  }
   for(int i=0; i< m_numBox; i++)
   {
     struct v8xyxy b = m_yoloOut[i];
@@ -751,6 +2015,27 @@ void YOLOADAS::_OD_postProcessing()
 }
 
 
+// Candidates are taken with the loosest class thresholds, then go through
+// the per class NMS (_mergeDetections) before anything downstream sees them
+int YOLOADAS::_decodeCandidates(std::vector<struct v8xyxy> &candidates)
+{
+  float minConf = m_nmsParams.minConfThreshold();
+
+  if (m_rawHead)
+  {
+    m_rawDecoder->decode(m_detectionRawBuff, minConf, candidates);
+    m_droppedCandidates += m_rawDecoder->getLastDropped();
+  }
+  else
+  {
+    m_boxDecoder->decode(m_detectionBoxBuff, m_detectionConfBuff, m_detectionClsBuff, minConf, candidates);
+    m_droppedCandidates += m_boxDecoder->getLastDropped();
+  }
+
+  return (int)candidates.size();
+}
+
+
 void YOLOADAS::_rescaleBoundingBox(
     int bbx_num,
     struct v8xyxy *out,
@@ -758,17 +2043,16 @@ void YOLOADAS::_rescaleBoundingBox(
     int inputW, int inputH,
     int frameW, int frameH)
 {
-  float w_ratio = (float)inputW / (float)frameW;
-  float h_ratio = (float)inputH / (float)frameH;
+  LetterboxTransform tf = _getVideoTransform(frameW, frameH);
 
   for(int i=0; i<bbx_num; i++)
   {
     scaledOut[i].c = out[i].c;
     scaledOut[i].c_prob = out[i].c_prob;
-    scaledOut[i].x1 = (int)((float)out[i].x1 / w_ratio);
-    scaledOut[i].y1 = (int)((float)out[i].y1 / h_ratio);
-    scaledOut[i].x2 = (int)((float)out[i].x2 / w_ratio);
-    scaledOut[i].y2 = (int)((float)out[i].y2 / h_ratio);
+    scaledOut[i].x1 = (int)tf.inverseX((float)out[i].x1);
+    scaledOut[i].y1 = (int)tf.inverseY((float)out[i].y1);
+    scaledOut[i].x2 = (int)tf.inverseX((float)out[i].x2);
+    scaledOut[i].y2 = (int)tf.inverseY((float)out[i].y2);
 
     // Expand Bounding Box
     int w = scaledOut[i].x2 - scaledOut[i].x1;
@@ -796,6 +2080,20 @@ void YOLOADAS::_rescaleBoundingBox(
 }
 
 
+// Video to network coordinates, as the video frame would be preprocessed
+LetterboxTransform YOLOADAS::_getVideoTransform(int videoWidth, int videoHeight)
+{
+  cv::Rect roi = _clipInputROI(cv::Size(videoWidth, videoHeight));
+
+  LetterboxTransform tf = LetterboxTransform::make(
+    roi.size(), cv::Size(m_inputWidth, m_inputHeight), m_preprocessor->isLetterbox());
+  tf.offsetX = (float)roi.x;
+  tf.offsetY = (float)roi.y;
+
+  return tf;
+}
+
+
 float YOLOADAS::_getBboxOverlapRatio(BoundingBox &boxA, BoundingBox &boxB)
 {
   int iouX = max(boxA.x1, boxB.x1);
@@ -959,7 +2257,7 @@ void YOLOADAS::_getMainLaneAndLine(
   m_laneLineInfo.laneMaskInfo.yLaneBottom = m_yBottom;
 
   // Calculate yellow line ratio
-  float yellowRatio = (float)yellowCount / ((float)SEG_WIDTH * yDiff);
+  float yellowRatio = (float)yellowCount / ((float)m_modelShape.segWidth * yDiff);
 
   if (yDiff == 0)
   {
@@ -994,7 +2292,7 @@ void YOLOADAS::_getMainLaneAndLine(
 
 void YOLOADAS::_updateYBottom(int yBottom)
 {
-  float ratio = (float)abs(m_yBottom - yBottom) / (float)SEG_HEIGHT;
+  float ratio = (float)abs(m_yBottom - yBottom) / (float)m_modelShape.segHeight;
   if (ratio < 0.1 && m_yBottom != 0)
   {
     utils::updateIntList(m_yBottomList, yBottom, m_yBottomListSize);
@@ -1270,8 +2568,7 @@ bool YOLOADAS::getVehicleBoundingBox(
   Point pROI_TL = fcwROI.getCornerPoint()[0];
   Point pROI_TR = fcwROI.getCornerPoint()[1];
 
-  float wRatio = (float)m_inputWidth / (float)videoWidth;
-  float hRatio = (float)m_inputHeight / (float)videoHeight;
+  LetterboxTransform tf = _getVideoTransform(videoWidth, videoHeight);
 
   for(int i=0; i<m_numBox; i++)
   {
@@ -1283,8 +2580,8 @@ bool YOLOADAS::getVehicleBoundingBox(
 
       BoundingBox bbox(box.x1, box.y1, box.x2, box.y2, box.c);
 
-      float bboxWidth = (float)bbox.getWidth()/wRatio;
-      float bboxHeight = (float)bbox.getHeight()/hRatio;
+      float bboxWidth = (float)bbox.getWidth()/tf.scaleX;
+      float bboxHeight = (float)bbox.getHeight()/tf.scaleY;
 
       // filter out outliers
       if ((bboxWidth > (float)videoWidth*0.8) || (bboxHeight > (float)videoHeight*0.8))
@@ -1308,7 +2605,7 @@ bool YOLOADAS::getVehicleBoundingBox(
 
       // filter out vehicles that out of ROI
       Point cp = bbox.getCenterPoint();
-      if (cp.x/wRatio < pROI_TL.x || cp.x/wRatio > pROI_TR.x)
+      if (tf.inverseX(cp.x) < pROI_TL.x || tf.inverseX(cp.x) > pROI_TR.x)
       {
         m_logger->debug("cp = ({}, {})", cp.x, cp.y);
         m_logger->debug("pROI_TL = ({}, {})", pROI_TL.x, pROI_TL.y);
@@ -1350,8 +2647,7 @@ bool YOLOADAS::getRiderBoundingBox(
   Point pROI_TL = fcwROI.getCornerPoint()[0];
   Point pROI_TR = fcwROI.getCornerPoint()[1];
 
-  float wRatio = (float)m_inputWidth / (float)videoWidth;
-  float hRatio = (float)m_inputHeight / (float)videoHeight;
+  LetterboxTransform tf = _getVideoTransform(videoWidth, videoHeight);
 
   //
   vector<BoundingBox> tmpBboxList;
@@ -1368,7 +2664,7 @@ bool YOLOADAS::getRiderBoundingBox(
 
       // filter out vehicles that out of ROI
       Point cp = bbox.getCenterPoint();
-      if (cp.x/wRatio < pROI_TL.x || cp.x/wRatio > pROI_TR.x)
+      if (tf.inverseX(cp.x) < pROI_TL.x || tf.inverseX(cp.x) > pROI_TR.x)
       {
         m_logger->debug("filter out outliers - (1)");
         m_logger->debug("Out of FCW ROI");
@@ -1449,8 +2745,7 @@ bool YOLOADAS::getHumanBoundingBox(
   Point pROI_TL = fcwROI.getCornerPoint()[0];
   Point pROI_TR = fcwROI.getCornerPoint()[1];
 
-  float wRatio = (float)m_inputWidth / (float)videoWidth;
-  float hRatio = (float)m_inputHeight / (float)videoHeight;
+  LetterboxTransform tf = _getVideoTransform(videoWidth, videoHeight);
 
   for(int i=0; i<m_numBox; i++)
   {
@@ -1464,7 +2759,7 @@ bool YOLOADAS::getHumanBoundingBox(
 
       // filter out vehicles that out of ROI
       Point cp = bbox.getCenterPoint();
-      if (cp.x/wRatio < pROI_TL.x || cp.x/wRatio > pROI_TR.x)
+      if (tf.inverseX(cp.x) < pROI_TL.x || tf.inverseX(cp.x) > pROI_TR.x)
       {
         m_logger->debug("filter out outliers - (1)");
         m_logger->debug("Out of FCW ROI");
@@ -1499,9 +2794,6 @@ bool YOLOADAS::getRoadSignBoundingBox(
   Point pROI_TL = fcwROI.getCornerPoint()[0];
   Point pROI_TR = fcwROI.getCornerPoint()[1];
 
-  float wRatio = (float)m_inputWidth / (float)videoWidth;
-  float hRatio = (float)m_inputHeight / (float)videoHeight;
-
   //
   vector<BoundingBox> tmpBboxList;
 
@@ -1,9 +1,13 @@
 #ifndef __YOLOADAS__
 #define __YOLOADAS__
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <iostream>
 #include <string>
+#include <thread>
 
 // SNPE SDK
 #include "CheckRuntime.hpp"
@@ -13,6 +17,8 @@
 #include "DlSystem/RuntimeList.hpp"
 #include "DlSystem/UserBufferMap.hpp"
 #include "DlSystem/IUserBuffer.hpp"
+#include "DlSystem/IUserBufferFactory.hpp"
+#include "DlSystem/IBufferAttributes.hpp"
 #include "DlContainer/IDlContainer.hpp"
 #include "SNPE/SNPE.hpp"
 #include "SNPE/SNPEFactory.hpp"
@@ -28,6 +34,18 @@
 #include "point.hpp"
 #include "object.hpp"
 #include "bounding_box.hpp"
+#include "image_prefetcher.hpp"
+#include "tensor_record.hpp"
+#include "frame_dataset.hpp"
+#include "img_convert.hpp"
+#include "fused_preprocess.hpp"
+#include "model_shape.hpp"
+#include "raw_head_decoder.hpp"
+#include "box_head_decoder.hpp"
+#include "quantized_output.hpp"
+#include "half_float.hpp"
+#include "box_nms.hpp"
+#include "detection_buffer.hpp"
 #include "yolo_adas_decoder.hpp"
 #include "lane_line_calib.hpp"
 #include "lane_line.hpp"
@@ -41,20 +59,12 @@
 using namespace std;
 
 #define FILE_MODE 0
-#define MAX_YOLO_BBX  100
-// #define NUM_BBOX 5040     // NOTE: Change this according to image size: 192x320: 1260   288x512: 3024    384x640: 5040
-// #define INPUT_WIDTH 640
-// #define INPUT_HEIGHT 384
-// #define SEG_WIDTH 80
-// #define SEG_HEIGHT 48
-// #define NUM_DET_CLASSES 6
-
-#define NUM_BBOX 3780     // NOTE: Change this according to image size: 192x320: 1260   288x512: 3024    384x640: 5040
-#define INPUT_WIDTH 576
-#define INPUT_HEIGHT 320
-#define SEG_WIDTH 72
-#define SEG_HEIGHT 40
-#define NUM_DET_CLASSES 6
+#define MAX_YOLO_BBX  100      // default detection capacity
+// Input, anchor and seg map sizes are read from the model, see ModelShape
+
+#define BRIGHTNESS_SAMPLE_STEP 8      // brightness is estimated on every 8th pixel and row
+#define ENHANCE_LUT_TOLERANCE 0.02    // relative brightness change that rebuilds the enhancement LUT
+#define ENHANCE_LUT_MAX_DIFF 1        // levels the LUT may differ from the direct enhancement
 
 
 enum LaneLabel
@@ -97,7 +107,10 @@ unsigned int YOLOADAS_Decode(
 class YOLOADAS
 {
  public:
-  YOLOADAS(ADAS_Config_S *config);
+  // detectionCapacity: most detections kept per frame, the lowest scores
+  // are dropped first beyond it. 0 takes config->detectionCapacity, or
+  // MAX_YOLO_BBX when the config has none.
+  YOLOADAS(ADAS_Config_S *config, int detectionCapacity = 0);
   ~YOLOADAS();
 
   ///////////////////////////
@@ -107,14 +120,88 @@ class YOLOADAS
   // Inference
   bool run();
   bool run(cv::Mat &imgFrame);
+  bool run(
+    const uint8_t *y,
+    size_t yPitch,
+    const uint8_t *uv,
+    size_t uvPitch,
+    int width,
+    int height);
   void close();
 
   // I/O
   bool loadInput(std::string filePath);
   bool loadInput(cv::Mat &imgFrame);
+  bool loadInputNV12(
+    const uint8_t *y,
+    size_t yPitch,
+    const uint8_t *uv,
+    size_t uvPitch,
+    int width,
+    int height);
+  // The frame as loaded. An NV12 frame is converted on the first call and
+  // only while it is loaded: its planes have to stay valid from
+  // loadInputNV12() to the end of run(), after that only a frame converted
+  // before is returned.
+  bool getInputImage(cv::Mat &img);
+  void setLetterbox(bool enable);
+  // Outputs are in network input coordinates, this maps them to the frame
+  LetterboxTransform getInputTransform();
+  // Only this part of the frame (frame pixels) goes to the network, an empty
+  // rect means the whole frame
+  void setInputROI(const cv::Rect &roi);
+  cv::Rect getInputROI();
+
+  // Tiled inference: after the full frame each tile (frame pixels) is run
+  // at the network resolution and its detections are merged in. Can be
+  // changed between frames, no tiles means full frame only. Not while
+  // recording, the record only holds the full frame outputs.
+  bool setTiles(const vector<cv::Rect> &tiles);
+  vector<cv::Rect> getTiles();
+  // count tiles of tileSize spread across the frame, centered on row
+  // centerY, e.g. along the horizon. They overlap when count * tile width
+  // is larger than the frame width.
+  static vector<cv::Rect> makeBandTiles(cv::Size frameSize, int centerY, cv::Size tileSize, int count);
+
+  // NMS of the raw head candidates and the tile merge, both methods keep
+  // the same boxes. The grid one scales to thousands of candidates.
+  void setNmsMethod(NmsMethod method);
+  NmsMethod getNmsMethod();
+
+  // Confidence and IoU thresholds and a cap on the kept boxes per class
+  // (DetectionLabel), so that e.g. many road signs can't crowd out the
+  // vehicles. Classes not set use the global thresholds.
+  void setClassNmsParams(int classId, const ClassNmsParams &params);
+  ClassNmsParams getClassNmsParams(int classId);
+
+  // Candidates of one decode passed on to the NMS, the highest scores, 0
+  // for all of them
+  void setMaxCandidates(int maxCandidates);
+  int getMaxCandidates();
+
+  // Detections dropped over capacity in the last frame, and in total,
+  // including the candidates cut by setMaxCandidates
+  int getDetectionCapacity();
+  int getDetectionOverflow();
+  uint64_t getTotalDetectionOverflow();
   bool preProcessingFile(std::string imgPath);
   bool preProcessingMemory(cv::Mat &imgFrame);
   bool postProcessing();
+  bool postProcessing(const RecordedFrame &frame);
+
+  // Record & Replay, the full frame outputs only so not with tiles set
+  bool startRecording(const std::string &filePath, bool compress);
+  void stopRecording();
+  bool replay(
+    const std::string &filePath,
+    bool paced,
+    std::function<void(const RecordedFrame &)> onFrame = nullptr);
+  // Frames recorded with --frame_dump, each one goes through the whole
+  // pipeline. onFrame is called after its postprocessing.
+  bool replayFrames(
+    const std::string &filePath,
+    bool paced,
+    std::function<void(uint64_t frameIdx, int64_t timestampUs)> onFrame = nullptr);
 
   // Line
   bool getLineMask(cv::Mat &mask);
@@ -193,16 +280,41 @@ class YOLOADAS
 
   // I/O
   bool _initModelIO();
+  bool _getTensorDims(const std::string &name, std::vector<size_t> &dims);
+  size_t _getElementCount(const std::vector<size_t> &dims);
+  bool _initUserBuffers();
+  bool _getOutputQuantization(const std::string &name, QuantParams &params);
+  bool _commitInput();
+  bool _execute();
+  void _releaseNV12Frame();
+  bool _startPrefetch(const std::string& inputFile);
+  cv::Size _prefetchResizeTo();
   bool _loadImageFile(const std::string& inputFile);
   bool _imgPreprocessing();
+  void _calcBrightness();
+  void _updateEnhancementLUT();
   bool _getITensor(float* yoloOutput, const zdl::DlSystem::ITensor* tensor);
   bool _getOutputTensor();
+  bool _outputsReady();
+  void _dequantizeOutputs();
+  int _getOutputBuffers(float **buffList, int *sizeList);
+  bool _recordOutputTensor();
+  bool _loadRecordedTensor(const RecordedFrame &frame);
+  LetterboxTransform _getVideoTransform(int videoWidth, int videoHeight);
+  cv::Rect _clipInputROI(cv::Size frameSize);
+  cv::Rect _clipRect(const cv::Rect &rect, cv::Size frameSize);
+  bool _preprocessRegion(const cv::Rect &rect, LetterboxTransform &tf);
+
+  // Tiled inference
+  bool _runTiles();
+  int _mergeDetections(std::vector<struct v8xyxy> &boxes, DetectionBuffer &out, bool countOverflow);
 
   // Segmentation
   void _SEG_postProcessing();
 
   // Detection
-  void _OD_postProcessing();
+  void _OD_postProcessing(bool tilesPending);
+  int _decodeCandidates(std::vector<struct v8xyxy> &candidates);
   float _getBboxOverlapRatio(
     BoundingBox &boxA, BoundingBox &boxB);
 
@@ -240,7 +352,6 @@ class YOLOADAS
 
   // Mat
   cv::Mat m_img;
-  cv::Mat m_imgResized;
 
   // DLC
   std::unique_ptr<zdl::SNPE::SNPE> m_snpe = nullptr;
@@ -260,33 +371,71 @@ class YOLOADAS
   std::vector<float> m_inputBuff;
   zdl::DlSystem::TensorShape m_inputTensorShape;
   std::unique_ptr<zdl::DlSystem::ITensor> m_inputTensor;
+  std::string m_inputTensorName;
   cv::Size inputSize;
 
-  // Input (image enhancement)
+  // Input (8-bit), for the fixed point runtimes the 1/255 scale is folded
+  // into the input quantization and the network reads m_inputBuffU8 as is
+  bool m_inputU8 = false;
+  std::vector<uint8_t> m_inputBuffU8;
+
+  // Input (file prefetching), 0 workers to read files inline
+  ImagePrefetcher *m_prefetcher = nullptr;
+  std::string m_prefetchDir;
+  bool m_prefetchPreResize = false;
+  int m_prefetchWorkers = 2;
+  int m_prefetchLookAhead = 4;
+  int m_prefetchLogInterval = 100;
+
+  // Input (NV12), the planes belong to the caller and are dropped at the
+  // end of run()
+  FusedPreprocessor *m_preprocessor = nullptr;
+  imgConvert::Nv12Converter m_nv12Converter;
+  const uint8_t *m_nv12Y = nullptr;
+  const uint8_t *m_nv12UV = nullptr;
+  size_t m_nv12YPitch = 0;
+  size_t m_nv12UVPitch = 0;
+  cv::Size m_frameSize;
+
+  // Input ROI as set, and as clipped to the current frame
+  cv::Rect m_inputROI;
+  cv::Rect m_srcROI;
+
+  // Frame to network input coordinates of the current frame
+  LetterboxTransform m_inputTransform;
+
+  // Input (image enhancement), applied through the preprocessor's LUT
   float m_brightness;
   int m_calcBrightnessCounter;
+  cv::Mat m_brightnessSample;
+  imgConvert::Nv12Converter m_sampleConverter;
+  float m_enhanceLUTBrightness = 0.0f;
+  bool m_enhanceLUTValid = false;
+  // Cleared when the LUT doesn't match the direct enhancement
+  bool m_enhanceViaLUT = true;
+
+  // Output sizes of the loaded model
+  ModelShape m_modelShape;
 
   // Output (Line)
-  cv::Mat m_rawLine;
   cv::Mat m_lineMask;
   cv::Mat m_mainLineMask;
   cv::Mat m_horiLineMask;
   cv::Mat m_lineColor;
 
   // Output (Lane)
-  cv::Mat m_rawLane;
   cv::Mat m_laneMask;
   cv::Mat m_mainLaneMask;
   cv::Mat m_laneColor;
 
-  // Output (Yolo Decoder)
-  YOLOADAS_Decoder *m_decoder;
+  // Output (det_box, det_conf, det_cls decoder)
+  BoxHeadDecoder *m_boxDecoder = nullptr;
 
-  float* m_laneBuff;
-  float* m_lineBuff;
-  float* m_detectionBoxBuff;
-  float* m_detectionConfBuff;
-  float* m_detectionClsBuff;
+  float* m_laneBuff = nullptr;
+  float* m_lineBuff = nullptr;
+  float* m_detectionBoxBuff = nullptr;
+  float* m_detectionConfBuff = nullptr;
+  float* m_detectionClsBuff = nullptr;
 
   std::vector<std::string> m_outputTensorList = {
     "lane_output",
@@ -295,8 +444,47 @@ class YOLOADAS
     "det_conf",
     "det_cls"};
 
+  // Output (raw detection head), for models exported without the box and
+  // score post-processing, which then runs here instead of on the NPU
+  bool m_rawHead = false;
+  RawHeadDecoder *m_rawDecoder = nullptr;
+  float* m_detectionRawBuff = nullptr;
+  int m_detectionRawSize = 0;
+
+  std::vector<std::string> m_rawOutputTensorList = {
+    "lane_output",
+    "drive_output",
+    "det_raw"};
+
   zdl::DlSystem::TensorMap m_outputTensorMap;
 
+  // User supplied buffers, bound once to m_inputBuffU8 and the output
+  // buffers above so nothing is copied around the inference
+  bool m_useUserBuffers = false;
+  std::vector<std::unique_ptr<zdl::DlSystem::IUserBuffer>> m_userBuffers;
+  zdl::DlSystem::UserBufferMap m_inputBufferMap;
+  zdl::DlSystem::UserBufferMap m_outputBufferMap;
+
+  // 8-bit detection outputs, when the model keeps them quantized. Only the
+  // anchors above the confidence threshold are dequantized into the
+  // detection buffers above.
+  bool m_quantizedOutput = false;
+  std::vector<uint8_t> m_detectionBoxQ;
+  std::vector<uint8_t> m_detectionConfQ;
+  std::vector<uint8_t> m_detectionClsQ;
+  QuantizedDetectionFilter m_quantFilter;
+
+  // fp16 detection outputs, for runtimes that compute in fp16 anyway (GPU
+  // fp16 mode). Converted through m_quantFilter the same way.
+  bool m_halfOutput = false;
+  std::vector<uint16_t> m_detectionBoxH;
+  std::vector<uint16_t> m_detectionConfH;
+  std::vector<uint16_t> m_detectionClsH;
+
+  // Output (Record)
+  TensorRecordWriter *m_recorder = nullptr;
+  uint64_t m_recordSeq = 0;
+
   // Output (Lane Line Calibration)
   vector<cv::Point> m_currLeftPointList;
   vector<cv::Point> m_currRightPointList;
@@ -335,10 +523,23 @@ class YOLOADAS
 
   // Bounding Box
   float m_bboxExpandRatio = 1.0;
-  struct v8xyxy m_yoloOut[MAX_YOLO_BBX];
-  struct v8xyxy m_scaledOut[MAX_YOLO_BBX];
+  DetectionBuffer m_yoloOut;
   int m_numBox = 0;
 
+  // Tiled inference
+  vector<cv::Rect> m_tiles;
+  std::vector<struct v8xyxy> m_tileCandidates;
+  std::vector<float> m_tileSegSave;
+
+  // NMS, candidates of all classes in one pass with the class parameters
+  NmsMethod m_nmsMethod = NMS_PAIRWISE;
+  GridNms m_gridNms;
+  NmsParams m_nmsParams;
+  std::vector<struct v8xyxy> m_candidates;
+  std::vector<struct v8xyxy> m_nmsOut;
+  // Candidates cut by the decoder in this frame, counted at the last merge
+  int m_droppedCandidates = 0;
+
   // Threshold
   float confidenceThreshold = 0.5;
   float iouThreshold = 0.5;